@@ -0,0 +1,114 @@
+#include "arena_backing.h"
+#include <climits>
+#include <cstdint>
+#include <cstdlib>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define GUT_HAS_MMAP
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#if defined(__linux__)
+#include <sys/syscall.h>
+#endif
+
+using size_type = std::size_t;
+
+#ifdef GUT_HAS_MMAP
+namespace
+{
+	// the transparent huge page size of x86-64 and of arm64 with 4 KiB pages
+	constexpr size_type huge_page_size{ size_type{ 2 } << 20 };
+
+	// values of the kernel's mempolicy modes, so <numaif.h> is not required
+	constexpr int mpol_bind{ 2 };
+	constexpr int mpol_interleave{ 3 };
+
+	size_type round_up(size_type const n, size_type const align) noexcept
+	{
+		return (n + align - 1) & ~(align - 1);
+	}
+
+	size_type mapping_size(size_type const size, bool const huge_pages) noexcept
+	{
+		size_type const page{ static_cast<size_type>(::sysconf(_SC_PAGESIZE)) };
+		return round_up(size == 0 ? 1 : size, huge_pages ? huge_page_size : page);
+	}
+}
+#endif
+//////////////////////////////////////////////////////////////////////////////////
+// allocation
+//////////////////////////////////////////////////////////////////////////////////
+void* gut::arena_backing::allocate(size_type const size) const noexcept
+{
+#ifdef GUT_HAS_MMAP
+	if (!mapped)
+	{
+		return std::malloc(size);
+	}
+
+	size_type const len{ mapping_size(size, huge_pages) };
+
+	// huge pages are only used for ranges aligned to them, so over-map and
+	// trim the mapping to a huge page boundary
+	size_type const slack{ huge_pages ? huge_page_size : 0 };
+	void* p{ ::mmap(nullptr, len + slack, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS, -1, 0) };
+	if (p == MAP_FAILED)
+	{
+		return nullptr;
+	}
+
+	auto first = reinterpret_cast<std::uintptr_t>(p);
+	auto aligned = round_up(first, slack ? slack : 1);
+	if (aligned != first)
+	{
+		::munmap(p, aligned - first);
+	}
+	if (first + slack != aligned)
+	{
+		::munmap(reinterpret_cast<void*>(aligned + len), first + slack - aligned);
+	}
+	p = reinterpret_cast<void*>(aligned);
+
+#ifdef MADV_HUGEPAGE
+	// fails when transparent huge pages are disabled; small pages then back
+	// the arena as usual
+	if (huge_pages)
+	{
+		::madvise(p, len, MADV_HUGEPAGE);
+	}
+#endif
+
+#if defined(__linux__) && defined(SYS_mbind)
+	// nothing has been touched yet, so the policy covers every page; a kernel
+	// without NUMA support rejects it and the default policy stays
+	if (numa != gut::numa_policy::first_touch && node_mask != 0)
+	{
+		::syscall(SYS_mbind, p, len, numa == gut::numa_policy::bind ? mpol_bind : mpol_interleave,
+			&node_mask, sizeof(node_mask) * CHAR_BIT + 1, 0);
+	}
+#endif
+	return p;
+#else
+	return std::malloc(size);
+#endif
+}
+
+void gut::arena_backing::deallocate(void* p, size_type const size) const noexcept
+{
+#ifdef GUT_HAS_MMAP
+	if (mapped)
+	{
+		if (p)
+		{
+			::munmap(p, mapping_size(size, huge_pages));
+		}
+		return;
+	}
+#else
+	(void)size;
+#endif
+	std::free(p);
+}
@@ -0,0 +1,71 @@
+#ifndef GUT_ARENA_BACKING_H
+#define GUT_ARENA_BACKING_H
+
+#include <cstddef>
+
+namespace gut
+{
+	// how pages of a NUMA system are assigned to a mapped arena
+	enum class numa_policy
+	{
+		// pages land on the node of the thread that first writes them
+		first_touch,
+		// pages are only taken from the nodes in node_mask
+		bind,
+		// pages are spread round robin over the nodes in node_mask
+		interleave
+	};
+
+	// where the bytes of a contiguous_allocator come from.
+	//
+	// heap() is plain malloc. the other backings map the arena anonymously,
+	// ask for transparent huge pages and apply a NUMA policy before any page is
+	// touched. each request degrades gracefully: a kernel without huge page or
+	// NUMA support still gets a working mapping, and a platform without mmap
+	// falls back to the heap.
+	struct arena_backing
+	{
+		bool mapped;
+		bool huge_pages;
+		gut::numa_policy numa;
+		// bit i selects node i; only used by bind and interleave
+		unsigned long node_mask;
+
+		static constexpr arena_backing heap() noexcept
+		{
+			return{ false, false, gut::numa_policy::first_touch, 0 };
+		}
+
+		static constexpr arena_backing huge_pages_first_touch() noexcept
+		{
+			return{ true, true, gut::numa_policy::first_touch, 0 };
+		}
+
+		static constexpr arena_backing huge_pages_bound(unsigned long const nodes) noexcept
+		{
+			return{ true, true, gut::numa_policy::bind, nodes };
+		}
+
+		static constexpr arena_backing huge_pages_interleaved(unsigned long const nodes) noexcept
+		{
+			return{ true, true, gut::numa_policy::interleave, nodes };
+		}
+
+		// returns null on failure; size bytes can be released only through the
+		// same backing
+		void* allocate(std::size_t const size) const noexcept;
+		void deallocate(void* p, std::size_t const size) const noexcept;
+	};
+
+	constexpr bool operator==(arena_backing const& x, arena_backing const& y) noexcept
+	{
+		return x.mapped == y.mapped && x.huge_pages == y.huge_pages &&
+			x.numa == y.numa && x.node_mask == y.node_mask;
+	}
+
+	constexpr bool operator!=(arena_backing const& x, arena_backing const& y) noexcept
+	{
+		return !(x == y);
+	}
+}
+#endif // GUT_ARENA_BACKING_H
@@ -0,0 +1,157 @@
+// multi-threaded mutation throughput of a polymorphic_vector<B> under the
+// packed, per_element and per_chunk placements.
+//
+// every thread repeatedly mutates the elements it owns, either interleaved
+// (thread t owns every t-th element) or as one contiguous chunk. small packed
+// elements owned by different threads share cache lines; the padded
+// placements move them onto lines of their own.
+//
+// build from the repository root:
+//     g++ -std=c++14 -O2 -pthread -I. benchmarks/false_sharing_benchmark.cpp
+//         contiguous_allocator.cpp arena_backing.cpp simd_kernels.cpp handle_base.cpp
+//         -o false_sharing_benchmark
+
+#include "polymorphic_vector.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	struct counter
+	{
+		virtual ~counter() = default;
+		virtual void bump() noexcept = 0;
+	};
+
+	struct small_counter : counter
+	{
+		void bump() noexcept override
+		{
+			++value;
+		}
+
+		// volatile keeps every increment a store to the shared arena
+		volatile unsigned value{ 0 };
+	};
+
+	struct wide_counter : counter
+	{
+		void bump() noexcept override
+		{
+			++value;
+		}
+
+		volatile unsigned long long value{ 0 };
+	};
+
+	enum class ownership
+	{
+		interleaved,
+		chunked
+	};
+
+	using clock_type = std::chrono::steady_clock;
+
+	double run(gut::placement const p, ownership const own, std::size_t const threads,
+		std::size_t const count, std::size_t const rounds)
+	{
+		gut::polymorphic_vector<counter> pv{ 0, p };
+		for (std::size_t i{ 0 }; i != count; ++i)
+		{
+			if (i % 2 == 0)
+			{
+				pv.emplace_back<small_counter>();
+			}
+			else
+			{
+				pv.emplace_back<wide_counter>();
+			}
+		}
+
+		// the elements never move while the workers run, so each of them can
+		// cache its own pointers up front
+		std::vector<std::vector<counter*>> owned(threads);
+		std::size_t const per_thread{ count / threads };
+		for (std::size_t i{ 0 }; i != count; ++i)
+		{
+			std::size_t const t{ own == ownership::interleaved
+				? i % threads
+				: std::min(i / per_thread, threads - 1) };
+			owned[t].push_back(&pv[i]);
+		}
+
+		std::atomic<std::size_t> ready{ 0 };
+		std::atomic<bool> go{ false };
+		std::vector<std::thread> workers;
+
+		for (std::size_t t{ 0 }; t != threads; ++t)
+		{
+			workers.emplace_back([&, t]
+			{
+				++ready;
+				while (!go.load(std::memory_order_acquire))
+				{
+				}
+				for (std::size_t r{ 0 }; r != rounds; ++r)
+				{
+					for (counter* c : owned[t])
+					{
+						c->bump();
+					}
+				}
+			});
+		}
+
+		while (ready.load() != threads)
+		{
+		}
+
+		auto const start = clock_type::now();
+		go.store(true, std::memory_order_release);
+		for (auto& w : workers)
+		{
+			w.join();
+		}
+		std::chrono::duration<double> const elapsed{ clock_type::now() - start };
+
+		return double(count) * double(rounds) / elapsed.count();
+	}
+
+	void report(char const* name, gut::placement const p, ownership const own,
+		std::size_t const threads, std::size_t const count, std::size_t const rounds)
+	{
+		double const ops{ run(p, own, threads, count, rounds) };
+		std::printf("  %-22s %10.1f M mutations/s\n", name, ops / 1e6);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	std::size_t threads{ std::max(2u, std::thread::hardware_concurrency()) };
+	if (argc > 1)
+	{
+		threads = std::max<std::size_t>(1, std::strtoul(argv[1], nullptr, 10));
+	}
+
+	std::size_t const count{ threads * 64 };
+	std::size_t const rounds{ 200000 };
+
+	std::printf("%zu threads, %zu elements, %zu rounds, %zu byte lines\n",
+		threads, count, rounds, gut::destructive_interference_size);
+
+	std::printf("interleaved ownership\n");
+	report("packed", gut::placement::packed(), ownership::interleaved, threads, count, rounds);
+	report("per_element", gut::placement::per_element(), ownership::interleaved, threads, count, rounds);
+
+	std::printf("chunked ownership\n");
+	report("packed", gut::placement::packed(), ownership::chunked, threads, count, rounds);
+	report("per_chunk", gut::placement::per_chunk(count / threads), ownership::chunked,
+		threads, count, rounds);
+	report("per_element", gut::placement::per_element(), ownership::chunked, threads, count, rounds);
+}
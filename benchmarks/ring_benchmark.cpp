@@ -0,0 +1,219 @@
+// FIFO event queue throughput of polymorphic_ring<B> against
+// std::deque<std::unique_ptr<B>> and polymorphic_vector<B>.
+//
+// the queue is filled to a steady depth and then, for every event, the
+// oldest one is dispatched and popped and a new one is pushed. the events
+// are three types of different size, pushed in a fixed pseudo random
+// sequence. polymorphic_vector<B> pops through erase(begin()), which moves
+// every remaining handle and object, so it only runs at the small depths.
+//
+// build from the repository root:
+//     g++ -std=c++14 -O2 -I. benchmarks/ring_benchmark.cpp
+//         contiguous_allocator.cpp arena_backing.cpp simd_kernels.cpp handle_base.cpp
+//         -o ring_benchmark
+
+#include "polymorphic_ring.h"
+#include "polymorphic_vector.h"
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <memory>
+#include <vector>
+
+namespace
+{
+	struct event
+	{
+		virtual ~event() = default;
+		virtual std::uint64_t dispatch() const noexcept = 0;
+	};
+
+	struct tick : event
+	{
+		explicit tick(std::uint64_t const t) noexcept
+			: time{ t }
+		{}
+
+		std::uint64_t dispatch() const noexcept override
+		{
+			return time;
+		}
+
+		std::uint64_t time;
+	};
+
+	struct key_press : event
+	{
+		explicit key_press(std::uint64_t const t) noexcept
+			: time{ t }
+			, key{ static_cast<std::uint32_t>(t * 31) }
+			, modifiers{ static_cast<std::uint32_t>(t & 7) }
+		{}
+
+		std::uint64_t dispatch() const noexcept override
+		{
+			return time ^ key ^ modifiers;
+		}
+
+		std::uint64_t time;
+		std::uint32_t key;
+		std::uint32_t modifiers;
+	};
+
+	struct packet : event
+	{
+		explicit packet(std::uint64_t const t) noexcept
+			: time{ t }
+		{
+			for (std::size_t i{ 0 }; i != 6; ++i)
+			{
+				payload[i] = t + i;
+			}
+		}
+
+		std::uint64_t dispatch() const noexcept override
+		{
+			return time + payload[0] + payload[5];
+		}
+
+		std::uint64_t time;
+		std::uint64_t payload[6];
+	};
+
+	using clock_type = std::chrono::steady_clock;
+
+	// a fixed xorshift sequence, so every queue sees the same events
+	struct sequence
+	{
+		std::uint64_t state{ 0x9E3779B97F4A7C15ull };
+
+		unsigned next() noexcept
+		{
+			state ^= state << 13;
+			state ^= state >> 7;
+			state ^= state << 17;
+			return static_cast<unsigned>(state % 3);
+		}
+	};
+
+	struct ring_queue
+	{
+		gut::polymorphic_ring<event> q;
+
+		void push(unsigned const kind, std::uint64_t const t)
+		{
+			switch (kind)
+			{
+			case 0: q.emplace_back<tick>(t); break;
+			case 1: q.emplace_back<key_press>(t); break;
+			default: q.emplace_back<packet>(t); break;
+			}
+		}
+
+		std::uint64_t pop()
+		{
+			std::uint64_t const r{ q.front().dispatch() };
+			q.pop_front();
+			return r;
+		}
+	};
+
+	struct deque_queue
+	{
+		std::deque<std::unique_ptr<event>> q;
+
+		void push(unsigned const kind, std::uint64_t const t)
+		{
+			switch (kind)
+			{
+			case 0: q.emplace_back(new tick{ t }); break;
+			case 1: q.emplace_back(new key_press{ t }); break;
+			default: q.emplace_back(new packet{ t }); break;
+			}
+		}
+
+		std::uint64_t pop()
+		{
+			std::uint64_t const r{ q.front()->dispatch() };
+			q.pop_front();
+			return r;
+		}
+	};
+
+	struct vector_queue
+	{
+		gut::polymorphic_vector<event> q;
+
+		void push(unsigned const kind, std::uint64_t const t)
+		{
+			switch (kind)
+			{
+			case 0: q.emplace_back<tick>(t); break;
+			case 1: q.emplace_back<key_press>(t); break;
+			default: q.emplace_back<packet>(t); break;
+			}
+		}
+
+		std::uint64_t pop()
+		{
+			std::uint64_t const r{ q.front().dispatch() };
+			q.erase(q.begin());
+			return r;
+		}
+	};
+
+	// events per second through a queue held at the given depth
+	template<class Queue>
+	double run(std::size_t const depth, std::size_t const events, std::uint64_t& sink)
+	{
+		Queue queue;
+		sequence seq;
+		std::uint64_t t{ 0 };
+
+		for (std::size_t i{ 0 }; i != depth; ++i)
+		{
+			queue.push(seq.next(), t++);
+		}
+
+		auto const start = clock_type::now();
+		for (std::size_t i{ 0 }; i != events; ++i)
+		{
+			sink += queue.pop();
+			queue.push(seq.next(), t++);
+		}
+		std::chrono::duration<double> const elapsed{ clock_type::now() - start };
+
+		return events / elapsed.count();
+	}
+}
+
+int main(int argc, char** argv)
+{
+	std::size_t const events{ argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 20000000 };
+	std::size_t const depths[]{ 16, 1024, 65536, 1048576 };
+
+	std::uint64_t sink{ 0 };
+	std::printf("%-10s %18s %18s %18s\n", "depth", "ring Mevents/s", "deque Mevents/s", "vector Mevents/s");
+
+	for (std::size_t const depth : depths)
+	{
+		double const ring{ run<ring_queue>(depth, events, sink) };
+		double const deque{ run<deque_queue>(depth, events, sink) };
+
+		if (depth <= 1024)
+		{
+			double const vector{ run<vector_queue>(depth, events / 100, sink) };
+			std::printf("%-10zu %18.2f %18.2f %18.2f\n", depth, ring / 1e6, deque / 1e6, vector / 1e6);
+		}
+		else
+		{
+			std::printf("%-10zu %18.2f %18.2f %18s\n", depth, ring / 1e6, deque / 1e6, "-");
+		}
+	}
+
+	// keeps the dispatch results observable
+	std::printf("checksum %llu\n", static_cast<unsigned long long>(sink));
+}
@@ -0,0 +1,486 @@
+// replays a trace recorded with GUT_TRACE against polymorphic_vector<B>
+// under a chosen set of policies, and reports throughput, peak memory,
+// bytes relocated by growth and compaction, and fragmentation.
+//
+// the recorded element types are stood in for by blobs of the same
+// alignment (16 or 64) and a size rounded up to the next size class, with
+// the recorded trivial relocatability. each run replays the same trace, so
+// runs with different policies compare directly:
+//
+//     trace_replay app.trace --growth geometric:1.5 --compaction incremental
+//
+// options
+//     --placement   packed | element | chunk:N
+//     --growth      geometric[:F] | additive:BYTES:HANDLES | reserve:BYTES | adaptive[:F]
+//     --compaction  eager | incremental
+//     --backing     heap | huge
+//
+// build from the repository root:
+//     g++ -std=c++14 -O2 -DGUT_ALLOCATOR_HOOKS -I. benchmarks/trace_replay.cpp
+//         contiguous_allocator.cpp arena_backing.cpp simd_kernels.cpp handle_base.cpp trace.cpp
+//         -o trace_replay
+
+#include "polymorphic_vector.h"
+#include "trace.h"
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <memory>
+#include <vector>
+
+#ifndef GUT_ALLOCATOR_HOOKS
+#error "trace_replay counts relocated bytes through the allocator hooks; build with -DGUT_ALLOCATOR_HOOKS"
+#endif
+
+namespace
+{
+	using clock_type = std::chrono::steady_clock;
+
+	struct element
+	{
+		virtual ~element() = default;
+	};
+
+	template<std::size_t Size, std::size_t Align, bool Relocatable>
+	struct alignas(Align) blob final : element
+	{
+		// written like a constructor would, so that pages are touched
+		blob() noexcept
+		{
+			std::memset(payload, 0, sizeof(payload));
+		}
+
+		unsigned char payload[Size - sizeof(element)];
+	};
+}
+
+namespace gut
+{
+	template<std::size_t Size, std::size_t Align>
+	struct is_trivially_relocatable<blob<Size, Align, true>> : std::true_type {};
+}
+
+namespace
+{
+	using vector_type = gut::polymorphic_vector<element>;
+
+	// iterators assert on adding 0
+	vector_type::const_iterator position(vector_type const& v, std::uint64_t const i)
+	{
+		return i == 0 ? v.cbegin() : v.cbegin() + static_cast<std::ptrdiff_t>(i);
+	}
+
+	template<class T>
+	void emplace(vector_type& v)
+	{
+		v.emplace_back<T>();
+	}
+
+	template<class T>
+	void replace(vector_type& v, std::size_t const i)
+	{
+		v.replace<T>(position(v, i));
+	}
+
+	struct size_class
+	{
+		std::size_t size;
+		void(*emplace)(vector_type&);
+		void(*replace)(vector_type&, std::size_t const);
+	};
+
+	template<std::size_t Align, bool Relocatable, std::size_t... Sizes>
+	std::vector<size_class> make_classes()
+	{
+		return
+		{
+			{
+				Sizes,
+				&emplace<blob<Sizes, Align, Relocatable>>,
+				&replace<blob<Sizes, Align, Relocatable>>
+			}...
+		};
+	}
+
+	template<std::size_t Align, bool Relocatable>
+	std::vector<size_class> classes_16()
+	{
+		return make_classes<Align, Relocatable,
+			16, 32, 48, 64, 80, 96, 112, 128, 144, 160, 176, 192, 208, 224, 240, 256,
+			384, 512, 768, 1024, 2048, 4096>();
+	}
+
+	template<std::size_t Align, bool Relocatable>
+	std::vector<size_class> classes_64()
+	{
+		return make_classes<Align, Relocatable,
+			64, 128, 192, 256, 384, 512, 768, 1024, 2048, 4096>();
+	}
+
+	// the blob standing in for a recorded type; larger sizes share the
+	// largest class and larger alignments the 64 byte one
+	size_class const* stand_in(std::size_t const size, std::size_t const align, bool const relocatable)
+	{
+		static std::vector<size_class> const tables[2][2]
+		{
+			{ classes_16<16, false>(), classes_16<16, true>() },
+			{ classes_64<64, false>(), classes_64<64, true>() }
+		};
+
+		auto const& table = tables[align > 16][relocatable];
+		auto const it = std::find_if(table.begin(), table.end(),
+			[size](size_class const& c) { return c.size >= size; });
+
+		return it == table.end() ? &table.back() : &*it;
+	}
+
+	struct step
+	{
+		gut::trace_record record;
+		size_class const* type;
+	};
+
+	struct policies
+	{
+		gut::placement placement{ gut::placement::packed() };
+		gut::growth growth{ gut::growth::geometric() };
+		gut::compaction compaction{ gut::compaction::eager };
+		gut::arena_backing backing{ gut::arena_backing::heap() };
+	};
+
+	bool parse(int argc, char** argv, char const*& path, policies& p)
+	{
+		path = nullptr;
+		for (int i{ 1 }; i < argc; ++i)
+		{
+			char const* const arg{ argv[i] };
+			char const* const value{ i + 1 < argc ? argv[i + 1] : "" };
+
+			if (std::strcmp(arg, "--placement") == 0)
+			{
+				if (std::strcmp(value, "packed") == 0)
+					p.placement = gut::placement::packed();
+				else if (std::strcmp(value, "element") == 0)
+					p.placement = gut::placement::per_element();
+				else if (std::strncmp(value, "chunk:", 6) == 0)
+					p.placement = gut::placement::per_chunk(std::strtoull(value + 6, nullptr, 10));
+				else
+					return false;
+				++i;
+			}
+			else if (std::strcmp(arg, "--growth") == 0)
+			{
+				char* rest{ nullptr };
+				if (std::strncmp(value, "geometric", 9) == 0)
+					p.growth = gut::growth::geometric(value[9] == ':' ? std::strtod(value + 10, nullptr) : 2.0);
+				else if (std::strncmp(value, "adaptive", 8) == 0)
+					p.growth = gut::growth::adaptive(value[8] == ':' ? std::strtod(value + 9, nullptr) : 2.0);
+				else if (std::strncmp(value, "reserve:", 8) == 0)
+					p.growth = gut::growth::reserve(std::strtoull(value + 8, nullptr, 10));
+				else if (std::strncmp(value, "additive:", 9) == 0)
+				{
+					std::size_t const bytes{ std::strtoull(value + 9, &rest, 10) };
+					if (*rest != ':')
+						return false;
+					p.growth = gut::growth::additive(bytes, std::strtoull(rest + 1, nullptr, 10));
+				}
+				else
+					return false;
+				++i;
+			}
+			else if (std::strcmp(arg, "--compaction") == 0)
+			{
+				if (std::strcmp(value, "eager") == 0)
+					p.compaction = gut::compaction::eager;
+				else if (std::strcmp(value, "incremental") == 0)
+					p.compaction = gut::compaction::incremental;
+				else
+					return false;
+				++i;
+			}
+			else if (std::strcmp(arg, "--backing") == 0)
+			{
+				if (std::strcmp(value, "heap") == 0)
+					p.backing = gut::arena_backing::heap();
+				else if (std::strcmp(value, "huge") == 0)
+					p.backing = gut::arena_backing::huge_pages_first_touch();
+				else
+					return false;
+				++i;
+			}
+			else if (!path && arg[0] != '-')
+			{
+				path = arg;
+			}
+			else
+			{
+				return false;
+			}
+		}
+		return path != nullptr;
+	}
+
+	std::vector<step> load(char const* path)
+	{
+		gut::trace_reader reader{ path };
+		std::vector<step> steps;
+
+		gut::trace_record r;
+		while (reader.next(r))
+		{
+			size_class const* type{ nullptr };
+			if (r.op == gut::trace_op::emplace)
+			{
+				type = stand_in(r.args[1], r.args[2], r.trivially_relocatable);
+			}
+			else if (r.op == gut::trace_op::replace)
+			{
+				type = stand_in(r.args[2], r.args[3], r.trivially_relocatable);
+			}
+			steps.push_back({ r, type });
+		}
+		return steps;
+	}
+
+	std::size_t growth_relocated{ 0 };
+	std::size_t compaction_relocated{ 0 };
+
+	void on_growth(gut::allocator_event const& e)
+	{
+		growth_relocated += e.relocated_bytes;
+	}
+
+	void on_compaction(gut::allocator_event const& e)
+	{
+		compaction_relocated += e.relocated_bytes;
+	}
+
+	class replay
+	{
+	public:
+		explicit replay(policies const& p)
+			: policies_(p)
+		{}
+
+		void run(step const& s)
+		{
+			auto const& r = s.record;
+			if (r.op == gut::trace_op::create)
+			{
+				slot(r.container) = make(r.args[0]);
+				measure(r.container);
+				return;
+			}
+			if (r.op == gut::trace_op::destroy)
+			{
+				retire(r.container);
+				return;
+			}
+
+			// the objects stay put when live_ grows for another container
+			vector_type* const v{ &at(r.container) };
+
+			switch (r.op)
+			{
+			case gut::trace_op::emplace:
+				s.type->emplace(*v);
+				break;
+			case gut::trace_op::replace:
+				s.type->replace(*v, r.args[0]);
+				break;
+			case gut::trace_op::erase:
+				v->erase(position(*v, r.args[0]), position(*v, r.args[1]));
+				break;
+			case gut::trace_op::pop_back:
+				v->pop_back();
+				break;
+			case gut::trace_op::copy:
+				*v = at(r.args[0]);
+				break;
+			case gut::trace_op::move:
+				*v = std::move(at(r.args[0]));
+				measure(r.args[0]);
+				break;
+			case gut::trace_op::swap:
+				v->swap(at(r.args[0]));
+				measure(r.args[0]);
+				break;
+			case gut::trace_op::splice:
+				v->splice(position(*v, r.args[0]), std::move(at(r.args[1])));
+				measure(r.args[1]);
+				break;
+			case gut::trace_op::clear:
+				v->clear();
+				break;
+			case gut::trace_op::compact_in_order:
+				v->compact_in_order();
+				break;
+			case gut::trace_op::compact:
+				v->compact(static_cast<gut::packing>(r.args[0]));
+				break;
+			case gut::trace_op::compact_step:
+				v->compact_step(r.args[0]);
+				break;
+			default:
+				break;
+			}
+			measure(r.container);
+		}
+
+		// padding and gaps over the used range of every live container
+		void sample()
+		{
+			std::size_t waste{ 0 };
+			std::size_t span{ 0 };
+			for (auto const& v : live_)
+			{
+				if (v)
+				{
+					auto const s = v->stats();
+					waste += s.padding_bytes + s.gap_bytes;
+					span += s.bytes_used + s.padding_bytes + s.gap_bytes;
+				}
+			}
+
+			if (span)
+			{
+				double const f{ double(waste) / span };
+				sum_ += f;
+				worst_ = std::max(worst_, f);
+				++samples_;
+			}
+		}
+
+		std::size_t peak_footprint() const noexcept
+		{
+			return peak_;
+		}
+
+		double mean_fragmentation() const noexcept
+		{
+			return samples_ ? sum_ / samples_ : 0.0;
+		}
+
+		double worst_fragmentation() const noexcept
+		{
+			return worst_;
+		}
+
+	private:
+		std::unique_ptr<vector_type> make(std::size_t const capacity) const
+		{
+			std::unique_ptr<vector_type> v{ new vector_type{ capacity, policies_.placement, policies_.backing } };
+			v->set_growth(policies_.growth);
+			v->set_compaction(policies_.compaction);
+			return v;
+		}
+
+		std::unique_ptr<vector_type>& slot(std::uint64_t const id)
+		{
+			if (id >= live_.size())
+			{
+				live_.resize(id + 1);
+				footprint_.resize(id + 1, 0);
+			}
+			return live_[id];
+		}
+
+		// a container first seen in anything but create was alive before
+		// recording started; it begins empty
+		vector_type& at(std::uint64_t const id)
+		{
+			auto& v = slot(id);
+			if (!v)
+			{
+				v = make(0);
+			}
+			return *v;
+		}
+
+		void measure(std::uint64_t const id)
+		{
+			std::size_t const now{ live_[id]->footprint() };
+			total_ = total_ - footprint_[id] + now;
+			footprint_[id] = now;
+			peak_ = std::max(peak_, total_);
+		}
+
+		void retire(std::uint64_t const id)
+		{
+			slot(id).reset();
+			total_ -= footprint_[id];
+			footprint_[id] = 0;
+		}
+
+		policies policies_;
+		std::vector<std::unique_ptr<vector_type>> live_;
+		std::vector<std::size_t> footprint_;
+		std::size_t total_{ 0 };
+		std::size_t peak_{ 0 };
+		double sum_{ 0 };
+		double worst_{ 0 };
+		std::size_t samples_{ 0 };
+	};
+}
+
+int main(int argc, char** argv)
+{
+	char const* path;
+	policies p;
+	if (!parse(argc, argv, path, p))
+	{
+		std::fprintf(stderr,
+			"usage: %s TRACE [--placement packed|element|chunk:N]\n"
+			"    [--growth geometric[:F]|additive:BYTES:HANDLES|reserve:BYTES|adaptive[:F]]\n"
+			"    [--compaction eager|incremental] [--backing heap|huge]\n", argv[0]);
+		return 2;
+	}
+
+	try
+	{
+		std::vector<step> const steps{ load(path) };
+
+		gut::set_growth_hook(&on_growth);
+		gut::set_compaction_hook(&on_compaction);
+
+		// fragmentation is sampled a fixed number of times over the trace,
+		// with the stats() walks kept off the clock
+		constexpr std::size_t samples{ 100 };
+		std::size_t const every{ std::max<std::size_t>(1, steps.size() / samples) };
+
+		replay r{ p };
+		clock_type::duration elapsed{ 0 };
+		for (std::size_t i{ 0 }; i < steps.size(); i += every)
+		{
+			std::size_t const last{ std::min(steps.size(), i + every) };
+
+			auto const start = clock_type::now();
+			for (std::size_t k{ i }; k != last; ++k)
+			{
+				r.run(steps[k]);
+			}
+			elapsed += clock_type::now() - start;
+
+			r.sample();
+		}
+		double const seconds{ std::chrono::duration<double>{ elapsed }.count() };
+
+		std::printf("%-24s %zu\n", "operations", steps.size());
+		std::printf("%-24s %.2f\n", "Mops/s", steps.size() / seconds / 1e6);
+		std::printf("%-24s %zu\n", "peak footprint bytes", r.peak_footprint());
+		std::printf("%-24s %zu\n", "growth relocated bytes", growth_relocated);
+		std::printf("%-24s %zu\n", "compaction relocated", compaction_relocated);
+		std::printf("%-24s %.2f%% mean, %.2f%% worst\n", "fragmentation",
+			100.0 * r.mean_fragmentation(), 100.0 * r.worst_fragmentation());
+	}
+	catch (std::exception const& e)
+	{
+		std::fprintf(stderr, "%s\n", e.what());
+		return 1;
+	}
+}
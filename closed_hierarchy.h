@@ -0,0 +1,173 @@
+#ifndef GUT_CLOSED_HIERARCHY_H
+#define GUT_CLOSED_HIERARCHY_H
+
+#include "relocation_traits.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace gut
+{
+	namespace detail
+	{
+		template<class T, class... Ts>
+		struct index_of;
+
+		template<class T>
+		struct index_of<T>
+			: std::integral_constant<std::size_t, 0>
+		{};
+
+		template<class T, class... Ts>
+		struct index_of<T, T, Ts...>
+			: std::integral_constant<std::size_t, 0>
+		{};
+
+		template<class T, class U, class... Ts>
+		struct index_of<T, U, Ts...>
+			: std::integral_constant<std::size_t, 1 + index_of<T, Ts...>::value>
+		{};
+
+		constexpr bool all_of(std::initializer_list<bool> const values) noexcept
+		{
+			for (bool const v : values)
+			{
+				if (!v)
+				{
+					return false;
+				}
+			}
+			return true;
+		}
+
+		template<class D>
+		void destroy_one(void* p)
+		{
+			static_cast<D*>(p)->~D();
+		}
+
+		template<class D>
+		void copy_one(void* dst, void const* src)
+		{
+			::new (dst) D{ *static_cast<D const*>(src) };
+		}
+
+		// moves the object at src to dst, which may overlap it
+		template<class D>
+		void relocate_one(void* dst, void* src)
+		{
+			if (gut::is_trivially_relocatable<D>::value)
+			{
+				std::memmove(dst, src, sizeof(D));
+				return;
+			}
+
+			D* old_src{ static_cast<D*>(src) };
+			auto const d = static_cast<unsigned char*>(dst);
+			auto const s = static_cast<unsigned char*>(src);
+
+			if (d + sizeof(D) <= s || s + sizeof(D) <= d)
+			{
+				::new (dst) D{ std::move(*old_src) };
+				old_src->~D();
+			}
+			else
+			{
+				// constructing over the source would read bytes already written
+				std::aligned_storage_t<sizeof(D), alignof(D)> tmp;
+				D* t{ ::new (&tmp) D{ std::move(*old_src) } };
+				old_src->~D();
+				::new (dst) D{ std::move(*t) };
+				t->~D();
+			}
+		}
+	}
+
+	// everything a container needs to know about a closed set of types Ds
+	// derived from B, computed at compile time. the types are identified by
+	// their position in Ds, which fits a uint8_t, and the tables below are
+	// indexed by it in place of the virtual calls of handle_base.
+	template<class B, class... Ds>
+	struct closed_hierarchy
+	{
+		using size_type = std::size_t;
+		using type_index_t = std::uint8_t;
+
+		using destroy_fn = void(*)(void*);
+		using copy_fn = void(*)(void*, void const*);
+		using relocate_fn = void(*)(void*, void*);
+
+		static_assert(sizeof...(Ds) != 0, "a closed hierarchy needs at least one type");
+		static_assert(sizeof...(Ds) <= 256, "a closed hierarchy indexes its types with a uint8_t");
+		static_assert(detail::all_of({ std::is_base_of<B, Ds>::value... }),
+			"every type of a closed hierarchy must derive from B");
+
+		static constexpr size_type type_count{ sizeof...(Ds) };
+		static constexpr size_type max_align{ std::max({ alignof(Ds)... }) };
+		static constexpr size_type max_size{ std::max({ sizeof(Ds)... }) };
+
+		static constexpr size_type sizes[]{ sizeof(Ds)... };
+		static constexpr size_type aligns[]{ alignof(Ds)... };
+		static constexpr bool trivially_relocatable{
+			detail::all_of({ gut::is_trivially_relocatable<Ds>::value... }) };
+
+		// true when every size is a multiple of max_align: elements packed from
+		// a max_align boundary then need no padding between them
+		static constexpr bool sizes_aligned{ detail::all_of({ sizeof(Ds) % max_align == 0 ... }) };
+
+		static constexpr destroy_fn destroy[]{ &detail::destroy_one<Ds>... };
+		static constexpr copy_fn copy[]{ &detail::copy_one<Ds>... };
+		static constexpr relocate_fn relocate[]{ &detail::relocate_one<Ds>... };
+
+		template<class D>
+		static constexpr bool contains() noexcept
+		{
+			return detail::index_of<D, Ds...>::value != sizeof...(Ds);
+		}
+
+		template<class D>
+		static constexpr type_index_t index_of() noexcept
+		{
+			static_assert(contains<D>(), "D is not a member of the closed hierarchy");
+			return static_cast<type_index_t>(detail::index_of<D, Ds...>::value);
+		}
+	};
+}
+//////////////////////////////////////////////////////////////////////////////////
+// static data
+//////////////////////////////////////////////////////////////////////////////////
+template<class B, class... Ds>
+constexpr typename gut::closed_hierarchy<B, Ds...>::size_type gut::closed_hierarchy<B, Ds...>::type_count;
+
+template<class B, class... Ds>
+constexpr typename gut::closed_hierarchy<B, Ds...>::size_type gut::closed_hierarchy<B, Ds...>::max_align;
+
+template<class B, class... Ds>
+constexpr typename gut::closed_hierarchy<B, Ds...>::size_type gut::closed_hierarchy<B, Ds...>::max_size;
+
+template<class B, class... Ds>
+constexpr typename gut::closed_hierarchy<B, Ds...>::size_type gut::closed_hierarchy<B, Ds...>::sizes[];
+
+template<class B, class... Ds>
+constexpr typename gut::closed_hierarchy<B, Ds...>::size_type gut::closed_hierarchy<B, Ds...>::aligns[];
+
+template<class B, class... Ds>
+constexpr bool gut::closed_hierarchy<B, Ds...>::trivially_relocatable;
+
+template<class B, class... Ds>
+constexpr bool gut::closed_hierarchy<B, Ds...>::sizes_aligned;
+
+template<class B, class... Ds>
+constexpr typename gut::closed_hierarchy<B, Ds...>::destroy_fn gut::closed_hierarchy<B, Ds...>::destroy[];
+
+template<class B, class... Ds>
+constexpr typename gut::closed_hierarchy<B, Ds...>::copy_fn gut::closed_hierarchy<B, Ds...>::copy[];
+
+template<class B, class... Ds>
+constexpr typename gut::closed_hierarchy<B, Ds...>::relocate_fn gut::closed_hierarchy<B, Ds...>::relocate[];
+#endif // GUT_CLOSED_HIERARCHY_H
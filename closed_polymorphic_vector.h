@@ -0,0 +1,838 @@
+#ifndef GUT_CLOSED_POLYMORPHIC_VECTOR_H
+#define GUT_CLOSED_POLYMORPHIC_VECTOR_H
+
+#include "closed_hierarchy.h"
+#include "polymorphic_vector.h"
+#include "simd_kernels.h"
+#include <cassert>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace gut
+{
+	// iterator over a polymorphic_vector<B, Ds...>; one offset load per access
+	template<class B, bool is_const>
+	class closed_polymorphic_vector_iterator final
+	{
+	public:
+		using iterator_category = std::random_access_iterator_tag;
+		using value_type = B;
+		using difference_type = std::ptrdiff_t;
+		using pointer = std::conditional_t<is_const, B const*, B*>;
+		using reference = std::conditional_t<is_const, B const&, B&>;
+
+		closed_polymorphic_vector_iterator() noexcept
+			: data_{ nullptr }
+			, offset_{ nullptr }
+		{}
+
+		template
+		<
+			bool other_const,
+			std::enable_if_t<is_const && !other_const, int> = 0
+		>
+		closed_polymorphic_vector_iterator(
+			closed_polymorphic_vector_iterator<B, other_const> const& it) noexcept
+			: data_{ it.data_ }
+			, offset_{ it.offset_ }
+		{}
+
+		reference operator*() const noexcept
+		{
+			return *reinterpret_cast<pointer>(data_ + *offset_);
+		}
+
+		pointer operator->() const noexcept
+		{
+			return reinterpret_cast<pointer>(data_ + *offset_);
+		}
+
+		reference operator[](difference_type const i) const noexcept
+		{
+			return *reinterpret_cast<pointer>(data_ + offset_[i]);
+		}
+
+		closed_polymorphic_vector_iterator& operator++() noexcept
+		{
+			++offset_;
+			return *this;
+		}
+
+		closed_polymorphic_vector_iterator& operator--() noexcept
+		{
+			--offset_;
+			return *this;
+		}
+
+		closed_polymorphic_vector_iterator operator++(int) noexcept
+		{
+			return{ data_, offset_++ };
+		}
+
+		closed_polymorphic_vector_iterator operator--(int) noexcept
+		{
+			return{ data_, offset_-- };
+		}
+
+		closed_polymorphic_vector_iterator& operator+=(difference_type const n) noexcept
+		{
+			offset_ += n;
+			return *this;
+		}
+
+		closed_polymorphic_vector_iterator& operator-=(difference_type const n) noexcept
+		{
+			offset_ -= n;
+			return *this;
+		}
+
+		friend closed_polymorphic_vector_iterator operator+(
+			closed_polymorphic_vector_iterator const& lhs, difference_type const n) noexcept
+		{
+			return{ lhs.data_, lhs.offset_ + n };
+		}
+
+		friend closed_polymorphic_vector_iterator operator+(
+			difference_type const n, closed_polymorphic_vector_iterator const& rhs) noexcept
+		{
+			return{ rhs.data_, rhs.offset_ + n };
+		}
+
+		friend closed_polymorphic_vector_iterator operator-(
+			closed_polymorphic_vector_iterator const& lhs, difference_type const n) noexcept
+		{
+			return{ lhs.data_, lhs.offset_ - n };
+		}
+
+		friend difference_type operator-(closed_polymorphic_vector_iterator const& lhs,
+			closed_polymorphic_vector_iterator const& rhs) noexcept
+		{
+			return lhs.offset_ - rhs.offset_;
+		}
+
+		friend bool operator==(closed_polymorphic_vector_iterator const& lhs,
+			closed_polymorphic_vector_iterator const& rhs) noexcept
+		{
+			return lhs.offset_ == rhs.offset_;
+		}
+
+		friend bool operator!=(closed_polymorphic_vector_iterator const& lhs,
+			closed_polymorphic_vector_iterator const& rhs) noexcept
+		{
+			return lhs.offset_ != rhs.offset_;
+		}
+
+		friend bool operator<(closed_polymorphic_vector_iterator const& lhs,
+			closed_polymorphic_vector_iterator const& rhs) noexcept
+		{
+			return lhs.offset_ < rhs.offset_;
+		}
+
+		friend bool operator<=(closed_polymorphic_vector_iterator const& lhs,
+			closed_polymorphic_vector_iterator const& rhs) noexcept
+		{
+			return lhs.offset_ <= rhs.offset_;
+		}
+
+		friend bool operator>(closed_polymorphic_vector_iterator const& lhs,
+			closed_polymorphic_vector_iterator const& rhs) noexcept
+		{
+			return lhs.offset_ > rhs.offset_;
+		}
+
+		friend bool operator>=(closed_polymorphic_vector_iterator const& lhs,
+			closed_polymorphic_vector_iterator const& rhs) noexcept
+		{
+			return lhs.offset_ >= rhs.offset_;
+		}
+
+	private:
+		template<class, class...> friend class polymorphic_vector;
+		template<class, bool> friend class closed_polymorphic_vector_iterator;
+
+		using byte_pointer = std::conditional_t<is_const, unsigned char const*, unsigned char*>;
+
+		closed_polymorphic_vector_iterator(byte_pointer data, std::size_t const* offset) noexcept
+			: data_{ data }
+			, offset_{ offset }
+		{}
+
+		byte_pointer data_;
+		std::size_t const* offset_;
+	};
+
+	// polymorphic_vector over a closed hierarchy: only D and Ds, all derived
+	// from B, can be stored. sizes, alignments and the destroy, copy and
+	// relocate functions of every type are known at compile time, so elements
+	// need no handle_base; each is described by its arena offset and a uint8_t
+	// index into the tables of gut::closed_hierarchy.
+	//
+	// like polymorphic_vector<B>, objects are packed in element order and B is
+	// expected at the start of every D.
+	template<class B, class D, class... Ds>
+	class polymorphic_vector<B, D, Ds...>
+	{
+	public:
+		using hierarchy = gut::closed_hierarchy<B, D, Ds...>;
+		using byte = unsigned char;
+		using type_index_t = typename hierarchy::type_index_t;
+
+		using value_type = B;
+		using reference = value_type&;
+		using const_reference = value_type const&;
+		using pointer = value_type*;
+		using const_pointer = value_type const*;
+
+		using iterator = gut::closed_polymorphic_vector_iterator<B, false>;
+		using const_iterator = gut::closed_polymorphic_vector_iterator<B, true>;
+		using reverse_iterator = std::reverse_iterator<iterator>;
+		using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+		using size_type = std::size_t;
+		using difference_type = typename iterator::difference_type;
+
+		// iterators
+		iterator begin() noexcept;
+		const_iterator begin() const noexcept;
+		iterator end() noexcept;
+		const_iterator end() const noexcept;
+
+		reverse_iterator rbegin() noexcept;
+		const_reverse_iterator rbegin() const noexcept;
+		reverse_iterator rend() noexcept;
+		const_reverse_iterator rend() const noexcept;
+
+		const_iterator cbegin() const noexcept;
+		const_iterator cend() const noexcept;
+		const_reverse_iterator crbegin() const noexcept;
+		const_reverse_iterator crend() const noexcept;
+
+		// destructor
+		~polymorphic_vector();
+
+		// constructors
+		explicit polymorphic_vector(size_type const capacity = 0);
+
+		polymorphic_vector(polymorphic_vector&& other) noexcept;
+		polymorphic_vector& operator=(polymorphic_vector&& other) noexcept;
+
+		polymorphic_vector(polymorphic_vector const& other);
+		polymorphic_vector& operator=(polymorphic_vector const& other);
+
+		// modifiers
+		template<class T, gut::enable_if_derived_t<B, T> = 0>
+		void push_back(T&& value);
+
+		template<class T, class... Args, gut::enable_if_derived_t<B, T> = 0>
+		void emplace_back(Args&&... args);
+
+		iterator erase(const_iterator position);
+		iterator erase(const_iterator begin, const_iterator end);
+
+		void pop_back();
+		void swap(polymorphic_vector& other) noexcept;
+		void clear();
+
+		// element access
+		reference operator[](size_type const i) noexcept;
+		const_reference operator[](size_type const i) const noexcept;
+
+		reference at(size_type const i);
+		const_reference at(size_type const i) const;
+
+		reference front() noexcept;
+		const_reference front() const noexcept;
+
+		reference back() noexcept;
+		const_reference back() const noexcept;
+
+		// position of the dynamic type of element i in <D, Ds...>
+		type_index_t type_index(size_type const i) const noexcept;
+
+		template<class T>
+		static constexpr type_index_t index_of() noexcept;
+
+		// capacity
+		size_type size() const noexcept;
+		bool empty() const noexcept;
+
+	private:
+		void destroy(size_type i, size_type const j) noexcept;
+
+		// packs the elements from i onwards behind end and returns the new end
+		byte* relocate(byte* end, size_type i);
+
+		// moves the elements from i onwards towards end with one memmove by the
+		// largest multiple of max_align that fits, and returns the new end;
+		// only for trivially relocatable hierarchies
+		byte* shift(byte* end, size_type const i) noexcept;
+
+		void grow(size_type const ncap);
+
+		// an upper bound of the bytes needed to pack every element in order
+		size_type packed_bound() const noexcept;
+
+		void ensure_index_bounds(size_type const i) const;
+
+		byte* data_;
+		size_type offset_;
+		size_type cap_;
+		std::vector<size_type> offsets_;
+		std::vector<type_index_t> types_;
+	};
+}
+//////////////////////////////////////////////////////////////////////////////////
+// iterators
+//////////////////////////////////////////////////////////////////////////////////
+template<class B, class D, class... Ds>
+inline typename gut::polymorphic_vector<B, D, Ds...>::iterator
+gut::polymorphic_vector<B, D, Ds...>::begin() noexcept
+{
+	return{ data_, offsets_.data() };
+}
+
+template<class B, class D, class... Ds>
+inline typename gut::polymorphic_vector<B, D, Ds...>::const_iterator
+gut::polymorphic_vector<B, D, Ds...>::begin() const noexcept
+{
+	return{ data_, offsets_.data() };
+}
+
+template<class B, class D, class... Ds>
+inline typename gut::polymorphic_vector<B, D, Ds...>::iterator
+gut::polymorphic_vector<B, D, Ds...>::end() noexcept
+{
+	return{ data_, offsets_.data() + offsets_.size() };
+}
+
+template<class B, class D, class... Ds>
+inline typename gut::polymorphic_vector<B, D, Ds...>::const_iterator
+gut::polymorphic_vector<B, D, Ds...>::end() const noexcept
+{
+	return{ data_, offsets_.data() + offsets_.size() };
+}
+
+template<class B, class D, class... Ds>
+inline typename gut::polymorphic_vector<B, D, Ds...>::reverse_iterator
+gut::polymorphic_vector<B, D, Ds...>::rbegin() noexcept
+{
+	return reverse_iterator{ end() };
+}
+
+template<class B, class D, class... Ds>
+inline typename gut::polymorphic_vector<B, D, Ds...>::const_reverse_iterator
+gut::polymorphic_vector<B, D, Ds...>::rbegin() const noexcept
+{
+	return const_reverse_iterator{ end() };
+}
+
+template<class B, class D, class... Ds>
+inline typename gut::polymorphic_vector<B, D, Ds...>::reverse_iterator
+gut::polymorphic_vector<B, D, Ds...>::rend() noexcept
+{
+	return reverse_iterator{ begin() };
+}
+
+template<class B, class D, class... Ds>
+inline typename gut::polymorphic_vector<B, D, Ds...>::const_reverse_iterator
+gut::polymorphic_vector<B, D, Ds...>::rend() const noexcept
+{
+	return const_reverse_iterator{ begin() };
+}
+
+template<class B, class D, class... Ds>
+inline typename gut::polymorphic_vector<B, D, Ds...>::const_iterator
+gut::polymorphic_vector<B, D, Ds...>::cbegin() const noexcept
+{
+	return begin();
+}
+
+template<class B, class D, class... Ds>
+inline typename gut::polymorphic_vector<B, D, Ds...>::const_iterator
+gut::polymorphic_vector<B, D, Ds...>::cend() const noexcept
+{
+	return end();
+}
+
+template<class B, class D, class... Ds>
+inline typename gut::polymorphic_vector<B, D, Ds...>::const_reverse_iterator
+gut::polymorphic_vector<B, D, Ds...>::crbegin() const noexcept
+{
+	return rbegin();
+}
+
+template<class B, class D, class... Ds>
+inline typename gut::polymorphic_vector<B, D, Ds...>::const_reverse_iterator
+gut::polymorphic_vector<B, D, Ds...>::crend() const noexcept
+{
+	return rend();
+}
+//////////////////////////////////////////////////////////////////////////////////
+// destructor
+//////////////////////////////////////////////////////////////////////////////////
+template<class B, class D, class... Ds>
+inline gut::polymorphic_vector<B, D, Ds...>::~polymorphic_vector()
+{
+	destroy(0, types_.size());
+	std::free(data_);
+}
+//////////////////////////////////////////////////////////////////////////////////
+// constructors/assignment
+//////////////////////////////////////////////////////////////////////////////////
+template<class B, class D, class... Ds>
+inline gut::polymorphic_vector<B, D, Ds...>::polymorphic_vector(size_type const capacity)
+	: data_{ static_cast<byte*>(std::malloc(capacity)) }
+	, offset_{ 0 }
+	, cap_{ 0 }
+{
+	if (data_)
+	{
+		cap_ = capacity;
+	}
+	else
+	{
+		throw std::bad_alloc{};
+	}
+}
+
+template<class B, class D, class... Ds>
+inline gut::polymorphic_vector<B, D, Ds...>::polymorphic_vector(polymorphic_vector&& other) noexcept
+	: data_{ other.data_ }
+	, offset_{ other.offset_ }
+	, cap_{ other.cap_ }
+	, offsets_{ std::move(other.offsets_) }
+	, types_{ std::move(other.types_) }
+{
+	other.data_ = nullptr;
+	other.offset_ = 0;
+	other.cap_ = 0;
+	other.offsets_.clear();
+	other.types_.clear();
+}
+
+template<class B, class D, class... Ds>
+inline gut::polymorphic_vector<B, D, Ds...>&
+gut::polymorphic_vector<B, D, Ds...>::operator=(polymorphic_vector&& other) noexcept
+{
+	if (this != &other)
+	{
+		polymorphic_vector tmp{ std::move(other) };
+		swap(tmp);
+	}
+	return *this;
+}
+
+template<class B, class D, class... Ds>
+gut::polymorphic_vector<B, D, Ds...>::polymorphic_vector(polymorphic_vector const& other)
+	: polymorphic_vector(other.offset_)
+{
+	offsets_.reserve(other.types_.size());
+	types_.reserve(other.types_.size());
+
+	// data_ may be aligned differently from other.data_, so the elements are
+	// packed again rather than copied to the same offsets
+	for (size_type i{ 0 }, sz{ other.types_.size() }; i != sz; ++i)
+	{
+		type_index_t const t{ other.types_[i] };
+		byte* blk{ data_ + offset_ };
+		byte* src{ make_aligned(blk, hierarchy::aligns[t]) };
+
+		if (src + hierarchy::sizes[t] > data_ + cap_)
+		{
+			grow((cap_ + hierarchy::sizes[t] + hierarchy::aligns[t]) * 2);
+			blk = data_ + offset_;
+			src = make_aligned(blk, hierarchy::aligns[t]);
+		}
+
+		hierarchy::copy[t](src, other.data_ + other.offsets_[i]);
+		offsets_.push_back(src - data_);
+		types_.push_back(t);
+		offset_ = src + hierarchy::sizes[t] - data_;
+	}
+}
+
+template<class B, class D, class... Ds>
+inline gut::polymorphic_vector<B, D, Ds...>&
+gut::polymorphic_vector<B, D, Ds...>::operator=(polymorphic_vector const& other)
+{
+	if (this != &other)
+	{
+		polymorphic_vector tmp{ other };
+		swap(tmp);
+	}
+	return *this;
+}
+//////////////////////////////////////////////////////////////////////////////////
+// modifiers
+//////////////////////////////////////////////////////////////////////////////////
+template<class B, class D, class... Ds>
+template<class T, gut::enable_if_derived_t<B, T>>
+inline void gut::polymorphic_vector<B, D, Ds...>::push_back(T&& value)
+{
+	emplace_back<std::decay_t<T>>(std::forward<T>(value));
+}
+
+template<class B, class D, class... Ds>
+template<class T, class... Args, gut::enable_if_derived_t<B, T>>
+inline void gut::polymorphic_vector<B, D, Ds...>::emplace_back(Args&&... args)
+{
+	static_assert(hierarchy::template contains<T>(),
+		"T is not a member of the closed hierarchy of this polymorphic_vector");
+
+	byte* blk{ data_ + offset_ };
+	byte* src{ make_aligned(blk, alignof(T)) };
+
+	if (src + sizeof(T) > data_ + cap_)
+	{
+		grow((cap_ + sizeof(T) + alignof(T)) * 2);
+		blk = data_ + offset_;
+		src = make_aligned(blk, alignof(T));
+	}
+
+	// the bookkeeping grows first, so a throwing constructor is the only
+	// failure left to roll back
+	offsets_.push_back(src - data_);
+	try
+	{
+		types_.push_back(hierarchy::template index_of<T>());
+	}
+	catch (...)
+	{
+		offsets_.pop_back();
+		throw;
+	}
+
+	try
+	{
+		::new (src) T{ std::forward<Args>(args)... };
+	}
+	catch (...)
+	{
+		offsets_.pop_back();
+		types_.pop_back();
+		throw;
+	}
+	offset_ = src + sizeof(T) - data_;
+}
+
+template<class B, class D, class... Ds>
+inline typename gut::polymorphic_vector<B, D, Ds...>::iterator
+gut::polymorphic_vector<B, D, Ds...>::erase(const_iterator position)
+{
+	return erase(position, position + 1);
+}
+
+template<class B, class D, class... Ds>
+typename gut::polymorphic_vector<B, D, Ds...>::iterator
+gut::polymorphic_vector<B, D, Ds...>::erase(const_iterator begin, const_iterator end)
+{
+	size_type const i = begin.offset_ - offsets_.data();
+	size_type const j = end.offset_ - offsets_.data();
+
+	assert(i <= j);
+	assert(j <= types_.size());
+
+	if (i != j)
+	{
+		// the erased range starts where the element in front of it ends
+		byte* block{ i == 0 ? data_ : data_ + offsets_[i - 1] + hierarchy::sizes[types_[i - 1]] };
+
+		destroy(i, j);
+		offsets_.erase(offsets_.begin() + i, offsets_.begin() + j);
+		types_.erase(types_.begin() + i, types_.begin() + j);
+
+		offset_ = (hierarchy::trivially_relocatable ? shift(block, i) : relocate(block, i)) - data_;
+	}
+	return{ data_, offsets_.data() + i };
+}
+
+template<class B, class D, class... Ds>
+inline void gut::polymorphic_vector<B, D, Ds...>::pop_back()
+{
+	assert(!types_.empty());
+
+	size_type const i{ types_.size() - 1 };
+	hierarchy::destroy[types_[i]](data_ + offsets_[i]);
+
+	offset_ = i == 0 ? 0 : offsets_[i - 1] + hierarchy::sizes[types_[i - 1]];
+	offsets_.pop_back();
+	types_.pop_back();
+}
+
+template<class B, class D, class... Ds>
+inline void gut::polymorphic_vector<B, D, Ds...>::swap(polymorphic_vector& other) noexcept
+{
+	std::swap(data_, other.data_);
+	std::swap(offset_, other.offset_);
+	std::swap(cap_, other.cap_);
+	offsets_.swap(other.offsets_);
+	types_.swap(other.types_);
+}
+
+template<class B, class D, class... Ds>
+inline void gut::polymorphic_vector<B, D, Ds...>::clear()
+{
+	destroy(0, types_.size());
+	offsets_.clear();
+	types_.clear();
+	offset_ = 0;
+}
+//////////////////////////////////////////////////////////////////////////////////
+// element access
+//////////////////////////////////////////////////////////////////////////////////
+template<class B, class D, class... Ds>
+inline typename gut::polymorphic_vector<B, D, Ds...>::reference
+gut::polymorphic_vector<B, D, Ds...>::operator[](size_type const i) noexcept
+{
+	return *reinterpret_cast<pointer>(data_ + offsets_[i]);
+}
+
+template<class B, class D, class... Ds>
+inline typename gut::polymorphic_vector<B, D, Ds...>::const_reference
+gut::polymorphic_vector<B, D, Ds...>::operator[](size_type const i) const noexcept
+{
+	return *reinterpret_cast<const_pointer>(data_ + offsets_[i]);
+}
+
+template<class B, class D, class... Ds>
+inline typename gut::polymorphic_vector<B, D, Ds...>::reference
+gut::polymorphic_vector<B, D, Ds...>::at(size_type const i)
+{
+	ensure_index_bounds(i);
+	return (*this)[i];
+}
+
+template<class B, class D, class... Ds>
+inline typename gut::polymorphic_vector<B, D, Ds...>::const_reference
+gut::polymorphic_vector<B, D, Ds...>::at(size_type const i) const
+{
+	ensure_index_bounds(i);
+	return (*this)[i];
+}
+
+template<class B, class D, class... Ds>
+inline typename gut::polymorphic_vector<B, D, Ds...>::reference
+gut::polymorphic_vector<B, D, Ds...>::front() noexcept
+{
+	return (*this)[0];
+}
+
+template<class B, class D, class... Ds>
+inline typename gut::polymorphic_vector<B, D, Ds...>::const_reference
+gut::polymorphic_vector<B, D, Ds...>::front() const noexcept
+{
+	return (*this)[0];
+}
+
+template<class B, class D, class... Ds>
+inline typename gut::polymorphic_vector<B, D, Ds...>::reference
+gut::polymorphic_vector<B, D, Ds...>::back() noexcept
+{
+	return (*this)[types_.size() - 1];
+}
+
+template<class B, class D, class... Ds>
+inline typename gut::polymorphic_vector<B, D, Ds...>::const_reference
+gut::polymorphic_vector<B, D, Ds...>::back() const noexcept
+{
+	return (*this)[types_.size() - 1];
+}
+
+template<class B, class D, class... Ds>
+inline typename gut::polymorphic_vector<B, D, Ds...>::type_index_t
+gut::polymorphic_vector<B, D, Ds...>::type_index(size_type const i) const noexcept
+{
+	return types_[i];
+}
+
+template<class B, class D, class... Ds>
+template<class T>
+inline constexpr typename gut::polymorphic_vector<B, D, Ds...>::type_index_t
+gut::polymorphic_vector<B, D, Ds...>::index_of() noexcept
+{
+	return hierarchy::template index_of<T>();
+}
+//////////////////////////////////////////////////////////////////////////////////
+// capacity
+//////////////////////////////////////////////////////////////////////////////////
+template<class B, class D, class... Ds>
+inline typename gut::polymorphic_vector<B, D, Ds...>::size_type
+gut::polymorphic_vector<B, D, Ds...>::size() const noexcept
+{
+	return types_.size();
+}
+
+template<class B, class D, class... Ds>
+inline bool gut::polymorphic_vector<B, D, Ds...>::empty() const noexcept
+{
+	return types_.empty();
+}
+///////////////////////////////////////////////////////////////////////////////
+// private member functions
+///////////////////////////////////////////////////////////////////////////////
+template<class B, class D, class... Ds>
+inline void gut::polymorphic_vector<B, D, Ds...>::destroy(size_type i, size_type const j) noexcept
+{
+	for (; i != j; ++i)
+	{
+		hierarchy::destroy[types_[i]](data_ + offsets_[i]);
+	}
+}
+
+template<class B, class D, class... Ds>
+typename gut::polymorphic_vector<B, D, Ds...>::byte*
+gut::polymorphic_vector<B, D, Ds...>::relocate(byte* end, size_type i)
+{
+	size_type const sz{ types_.size() };
+
+	if (hierarchy::sizes_aligned && i != sz)
+	{
+		// without padding between the elements their new offsets are a prefix
+		// sum of their sizes from the first max_align boundary
+		std::vector<size_type> next(sz - i);
+		for (size_type k{ i }; k != sz; ++k)
+		{
+			next[k - i] = hierarchy::sizes[types_[k]];
+		}
+		size_type const last{ gut::simd::exclusive_scan(next.data(), next.data(), next.size(),
+			make_aligned(end, hierarchy::max_align) - data_) };
+
+		for (size_type k{ i }; k != sz; ++k)
+		{
+			if (next[k - i] != offsets_[k])
+			{
+				hierarchy::relocate[types_[k]](data_ + next[k - i], data_ + offsets_[k]);
+				offsets_[k] = next[k - i];
+			}
+		}
+		return data_ + last;
+	}
+
+	for (; i != sz; ++i)
+	{
+		type_index_t const t{ types_[i] };
+		byte* src{ make_aligned(end, hierarchy::aligns[t]) };
+
+		if (src != data_ + offsets_[i])
+		{
+			hierarchy::relocate[t](src, data_ + offsets_[i]);
+			offsets_[i] = src - data_;
+		}
+		end = src + hierarchy::sizes[t];
+	}
+	return end;
+}
+
+template<class B, class D, class... Ds>
+typename gut::polymorphic_vector<B, D, Ds...>::byte*
+gut::polymorphic_vector<B, D, Ds...>::shift(byte* end, size_type const i) noexcept
+{
+	size_type const sz{ types_.size() };
+	if (i == sz)
+	{
+		return end;
+	}
+
+	// moving by a multiple of max_align keeps every element aligned, so the
+	// offsets all drop by the same delta; less than max_align bytes stay
+	// unused in front of element i
+	byte* first{ data_ + offsets_[i] };
+	size_type const delta{ (first - end) & ~(hierarchy::max_align - 1) };
+
+	if (delta != 0)
+	{
+		std::memmove(first - delta, first, offset_ - offsets_[i]);
+		gut::simd::add(offsets_.data() + i, sz - i, size_type(0) - delta);
+	}
+	return data_ + offset_ - delta;
+}
+
+template<class B, class D, class... Ds>
+void gut::polymorphic_vector<B, D, Ds...>::grow(size_type const ncap)
+{
+	if (hierarchy::trivially_relocatable)
+	{
+		// one copy of the whole arena to an address congruent to data_ modulo
+		// max_align keeps every element aligned; the offsets all move by the
+		// same shift and the gaps left by erase stay as they are
+		size_type const cap{ std::max(ncap, offset_ + hierarchy::max_size + 2 * hierarchy::max_align) };
+		byte* ndata{ static_cast<byte*>(std::malloc(cap)) };
+
+		if (!ndata)
+		{
+			throw std::bad_alloc{};
+		}
+
+		size_type const shift{ size_type(data_ - ndata) & (hierarchy::max_align - 1) };
+		if (offset_ != 0)
+		{
+			std::memcpy(ndata + shift, data_, offset_);
+			gut::simd::add(offsets_.data(), offsets_.size(), shift);
+		}
+
+		std::free(data_);
+		data_ = ndata;
+		offset_ += shift;
+		cap_ = cap;
+		return;
+	}
+
+	// the new block may be aligned differently, so the elements can need more
+	// padding than they had
+	size_type const cap{ std::max(ncap, packed_bound() + hierarchy::max_size + hierarchy::max_align) };
+	byte* ndata{ static_cast<byte*>(std::malloc(cap)) };
+
+	if (!ndata)
+	{
+		throw std::bad_alloc{};
+	}
+
+	byte* end{ ndata };
+	for (size_type i{ 0 }, sz{ types_.size() }; i != sz; ++i)
+	{
+		type_index_t const t{ types_[i] };
+		byte* src{ make_aligned(end, hierarchy::aligns[t]) };
+
+		hierarchy::relocate[t](src, data_ + offsets_[i]);
+		offsets_[i] = src - ndata;
+		end = src + hierarchy::sizes[t];
+	}
+
+	std::free(data_);
+	data_ = ndata;
+	offset_ = end - ndata;
+	cap_ = cap;
+}
+
+template<class B, class D, class... Ds>
+inline typename gut::polymorphic_vector<B, D, Ds...>::size_type
+gut::polymorphic_vector<B, D, Ds...>::packed_bound() const noexcept
+{
+	size_type bound{ 0 };
+	for (type_index_t const t : types_)
+	{
+		bound += hierarchy::sizes[t] + hierarchy::aligns[t] - 1;
+	}
+	return bound;
+}
+
+template<class B, class D, class... Ds>
+inline void gut::polymorphic_vector<B, D, Ds...>::ensure_index_bounds(size_type const i) const
+{
+	if (i >= types_.size())
+	{
+		throw std::out_of_range
+		{
+			"polymorphic_vector<B, Ds...>::ensure_index_bounds( size_type const i );\n"
+			"index out of range"
+		};
+	}
+}
+#endif // GUT_CLOSED_POLYMORPHIC_VECTOR_H
@@ -1,25 +1,71 @@
 #include "contiguous_allocator.h"
+#include <algorithm>
 #include <cassert>
+#include <cstring>
+#include <iterator>
 
 using byte = gut::contiguous_allocator::byte;
 using size_type = gut::contiguous_allocator::size_type;
 
 #define as_byte_ptr(ptr) reinterpret_cast<byte*>(ptr)
 
+namespace
+{
+	size_type scale(size_type const n, double const factor) noexcept
+	{
+		return static_cast<size_type>(static_cast<double>(n) * factor);
+	}
+}
+
+#ifdef GUT_ALLOCATOR_HOOKS
+namespace
+{
+	gut::allocator_hook growth_hook{ nullptr };
+	gut::allocator_hook compaction_hook{ nullptr };
+
+	void notify(gut::allocator_hook hook, gut::contiguous_allocator const* allocator,
+		size_type const old_capacity, size_type const new_capacity, size_type const relocated_bytes)
+	{
+		if (hook)
+		{
+			hook({ allocator, old_capacity, new_capacity, relocated_bytes });
+		}
+	}
+}
+
+void gut::set_growth_hook(allocator_hook hook) noexcept
+{
+	growth_hook = hook;
+}
+
+void gut::set_compaction_hook(allocator_hook hook) noexcept
+{
+	compaction_hook = hook;
+}
+#endif
+
 //////////////////////////////////////////////////////////////////////////////////
 // destructor
 //////////////////////////////////////////////////////////////////////////////////
 gut::contiguous_allocator::~contiguous_allocator() noexcept
 {
-	std::free(data_);
+	backing_.deallocate(data_, cap_);
+	GUT_TRACE_RECORD(trace(gut::trace_op::destroy, this));
 }
 //////////////////////////////////////////////////////////////////////////////////
 // constructors/assignment
 //////////////////////////////////////////////////////////////////////////////////
-gut::contiguous_allocator::contiguous_allocator(size_type const cap)
-	: data_{ as_byte_ptr(std::malloc(cap)) }
+gut::contiguous_allocator::contiguous_allocator(size_type const cap, gut::placement const p,
+	gut::arena_backing const b)
+	: data_{ as_byte_ptr(b.allocate(cap)) }
 	, offset_{ 0 }
 	, cap_{ 0 }
+	, in_order_{ true }
+	, placement_(p)
+	, compaction_{ gut::compaction::eager }
+	, growth_(gut::growth::geometric())
+	, backing_(b)
+	, counters_{}
 {
 	if (data_)
 	{
@@ -29,6 +75,7 @@ gut::contiguous_allocator::contiguous_allocator(size_type const cap)
 	{
 		throw std::bad_alloc{};
 	}
+	GUT_TRACE_RECORD(trace(gut::trace_op::create, this, cap));
 }
 
 gut::contiguous_allocator::contiguous_allocator(contiguous_allocator&& other) noexcept
@@ -37,37 +84,54 @@ gut::contiguous_allocator::contiguous_allocator(contiguous_allocator&& other) no
 	, data_{ other.data_ }
 	, offset_{ other.offset_ }
 	, cap_{ other.cap_ }
+	, in_order_{ other.in_order_ }
+	, placement_(other.placement_)
+	, compaction_{ other.compaction_ }
+	, growth_(other.growth_)
+	, backing_(other.backing_)
+	, counters_(other.counters_)
 {
 	other.data_ = nullptr;
+	GUT_TRACE_RECORD(trace(gut::trace_op::create, this, 0));
+	GUT_TRACE_RECORD(trace_pair(gut::trace_op::move, this, &other));
 }
 
 gut::contiguous_allocator& gut::contiguous_allocator::operator=(contiguous_allocator&& other) noexcept
 {
 	if (this != &other)
 	{
-		for (auto& h : handles_)
-		{
-			h->destroy();
-		}
+		destroy_elements(0, handles_.size());
 		sections_ = std::move(other.sections_);
 		handles_ = std::move(other.handles_);
-		std::free(data_);
+		backing_.deallocate(data_, cap_);
 		data_ = other.data_;
 		other.data_ = nullptr;
 		cap_ = other.cap_;
 		offset_ = other.offset_;
+		in_order_ = other.in_order_;
+		placement_ = other.placement_;
+		compaction_ = other.compaction_;
+		growth_ = other.growth_;
+		backing_ = other.backing_;
+		counters_ = other.counters_;
+		GUT_TRACE_RECORD(trace_pair(gut::trace_op::move, this, &other));
 	}
 	return *this;
 }
 
 gut::contiguous_allocator::contiguous_allocator(contiguous_allocator const& other)
-	: data_{ as_byte_ptr(std::malloc(other.offset_)) }
+	: data_{ as_byte_ptr(other.backing_.allocate(other.offset_)) }
 	, offset_{ 0 }
 	, cap_{ 0 }
+	, in_order_{ true }
+	, placement_(other.placement_)
+	, compaction_{ other.compaction_ }
+	, growth_(other.growth_)
+	, backing_(other.backing_)
+	, counters_{}
 {
 	if (data_)
 	{
-		offset_ = other.offset_;
 		cap_ = other.offset_;
 		copy(other);
 	}
@@ -75,6 +139,8 @@ gut::contiguous_allocator::contiguous_allocator(contiguous_allocator const& othe
 	{
 		throw std::bad_alloc{};
 	}
+	GUT_TRACE_RECORD(trace(gut::trace_op::create, this, other.offset_));
+	GUT_TRACE_RECORD(trace_pair(gut::trace_op::copy, this, &other));
 }
 
 gut::contiguous_allocator& gut::contiguous_allocator::operator=(contiguous_allocator const& other)
@@ -87,11 +153,12 @@ gut::contiguous_allocator& gut::contiguous_allocator::operator=(contiguous_alloc
 		}
 		else
 		{
-			byte* new_data = as_byte_ptr(std::malloc(other.offset_));
+			byte* new_data = as_byte_ptr(backing_.allocate(other.offset_));
 
 			if (new_data)
 			{
 				clear();
+				backing_.deallocate(data_, cap_);
 				data_ = new_data;
 				cap_ = other.offset_;
 			}
@@ -100,7 +167,11 @@ gut::contiguous_allocator& gut::contiguous_allocator::operator=(contiguous_alloc
 				throw std::bad_alloc{};
 			}
 		}
+		placement_ = other.placement_;
+		compaction_ = other.compaction_;
+		growth_ = other.growth_;
 		copy(other);
+		GUT_TRACE_RECORD(trace_pair(gut::trace_op::copy, this, &other));
 	}
 	return *this;
 }
@@ -112,22 +183,422 @@ void gut::contiguous_allocator::deallocate(size_type const i, size_type const j)
 	assert(i < j);
 	assert(j <= handles_.size());
 
-	erase_inner_sections(i, j);
-
-	auto block = destroy(i, j);
-	auto end = next_section(j);
-	
-	// merge right adjacent section
-	auto r_sec = to_section_index(end);
-	if (r_sec != sections_.size())
+	size_type relocated{ 0 };
+	if (compaction_ == gut::compaction::incremental && !in_order_)
 	{
-		sections_.erase(sections_.cbegin() + r_sec);
+		// putting the objects back in order is not bounded work; the erased
+		// bytes stay an untracked hole until the next compaction. so do the
+		// gaps in front of them: handle j, which takes index i, lies elsewhere
+		erase_inner_sections(i, j);
+
+		auto sec = to_section_index(i);
+		if (sec != sections_.size())
+		{
+			sections_.erase(sections_.begin() + sec);
+		}
+
+		destroy(i, j);
 	}
+	else
+	{
+		// compaction walks the handles in physical order
+		compact_in_order();
 
-	transfer(block, j, end);
+		erase_inner_sections(i, j);
+
+		auto block = destroy(i, j);
+		relocated = transfer(block, j, j - i,
+			compaction_ == gut::compaction::incremental ? 0 : size_type(-1));
+	}
 
 	auto handles_cbegin = handles_.cbegin();
 	handles_.erase(handles_cbegin + i, handles_cbegin + j);
+
+	for (auto& s : sections_)
+	{
+		if (s.handle_index > i)
+		{
+			s.handle_index -= j - i;
+		}
+	}
+
+	counters_.compaction_relocated_bytes += relocated;
+#ifdef GUT_ALLOCATOR_HOOKS
+	if (relocated)
+	{
+		notify(compaction_hook, this, cap_, cap_, relocated);
+	}
+#endif
+	GUT_TRACE_RECORD(trace(gut::trace_op::erase, this, i, j));
+}
+
+void gut::contiguous_allocator::deallocate_back()
+{
+	assert(!handles_.empty());
+
+	auto& h = handles_.back();
+	auto end = as_byte_ptr(h->src()) + h->size();
+
+	// out of order, the last handle need not own the last bytes of the arena;
+	// then its block and the gap in front of it are left as a hole
+	auto sec = to_section_index(handles_.size() - 1);
+	if (in_order_ || end == data_ + offset_)
+	{
+		offset_ = as_byte_ptr(h->blk()) - data_;
+
+		if (sec != sections_.size())
+		{
+			offset_ -= sections_[sec].available_size;
+		}
+	}
+	if (sec != sections_.size())
+	{
+		sections_.erase(sections_.begin() + sec);
+	}
+
+	h->destroy();
+	handles_.pop_back();
+	GUT_TRACE_RECORD(trace(gut::trace_op::pop_back, this));
+}
+
+void gut::contiguous_allocator::abandon(size_type const i)
+{
+	assert(i < handles_.size());
+
+	auto const& h = handles_[i];
+	byte* gap{ as_byte_ptr(h->blk()) };
+	auto const end = as_byte_ptr(h->src()) + h->size();
+
+	auto sec = to_section_index(i);
+	if (sec != sections_.size())
+	{
+		gap -= sections_[sec].available_size;
+		sections_.erase(sections_.begin() + sec);
+	}
+
+	handles_.erase(handles_.cbegin() + i);
+
+	for (auto& s : sections_)
+	{
+		if (s.handle_index > i)
+		{
+			--s.handle_index;
+		}
+	}
+
+	// the block and the gap in front of it go back to the end of the arena,
+	// into the gap of the next element in order, or else become an untracked
+	// hole until the next compaction
+	if (end == data_ + offset_)
+	{
+		offset_ = gap - data_;
+	}
+	else if (in_order_ && i < handles_.size())
+	{
+		size_type const available = as_byte_ptr(handles_[i]->blk()) - gap;
+		auto next = to_section_index(i);
+		if (next != sections_.size())
+		{
+			sections_[next].available_size = available;
+		}
+		else
+		{
+			insert_section(i, available);
+		}
+	}
+	GUT_TRACE_RECORD(trace(gut::trace_op::erase, this, i, i + 1));
+}
+
+void gut::contiguous_allocator::splice(size_type const pos, contiguous_allocator&& other)
+{
+	assert(pos <= handles_.size());
+	assert(this != &other);
+
+	if (other.handles_.empty())
+	{
+		return;
+	}
+
+	if (handles_.empty() && placement_.chunk == other.placement_.chunk &&
+		backing_ == other.backing_)
+	{
+		// adopt the whole arena and hand ours back to other; each buffer is
+		// released through the same backing either way, and the policies of
+		// both allocators stay their own
+		std::swap(sections_, other.sections_);
+		std::swap(handles_, other.handles_);
+		std::swap(data_, other.data_);
+		std::swap(offset_, other.offset_);
+		std::swap(cap_, other.cap_);
+		std::swap(in_order_, other.in_order_);
+		other.offset_ = 0;
+		other.sections_.clear();
+		other.in_order_ = true;
+		GUT_TRACE_RECORD(trace_pair(gut::trace_op::splice, this, &other, pos));
+		return;
+	}
+
+	size_type align{ 1 };
+	bool trivially_relocatable{ true };
+	for (auto const& h : other.handles_)
+	{
+		align = std::max(align, h->align());
+		trivially_relocatable = trivially_relocatable && h->is_trivially_relocatable();
+	}
+
+	// a block copy keeps the placement of other, which is only right if
+	// neither arena spaces its elements out, and its layout, which must be
+	// objects in handle order with no tracked gaps between them
+	size_type const n{ handles_.size() };
+	trivially_relocatable = trivially_relocatable &&
+		placement_.chunk == 0 && other.placement_.chunk == 0 &&
+		other.in_order_ && other.sections_.empty();
+
+	size_type required_size{ other.offset_ + align - 1 };
+	if (!trivially_relocatable)
+	{
+		required_size = 0;
+		for (size_type k{ 0 }, sz{ other.handles_.size() }; k != sz; ++k)
+		{
+			auto const& h = other.handles_[k];
+			required_size += h->size() + align_for(n + k, h->align()) - 1;
+		}
+	}
+	if (cap_ - offset_ < required_size)
+	{
+		grow(next_capacity(required_size), required_size);
+	}
+
+	size_type const m{ other.handles_.size() };
+	byte* blk{ data_ + offset_ };
+
+	if (trivially_relocatable)
+	{
+		// one block copy to an address congruent to the source modulo the
+		// strictest alignment, so every object stays aligned; the handles and
+		// the gaps between the objects are kept as they are
+		byte* dst{ blk + ((other.data_ - blk) & (align - 1)) };
+		std::memcpy(dst, other.data_, other.offset_);
+
+		std::ptrdiff_t const delta{ dst - other.data_ };
+		for (auto& h : other.handles_)
+		{
+			h->rebind(as_byte_ptr(h->blk()) + delta, as_byte_ptr(h->src()) + delta);
+		}
+		auto& first = other.handles_.front();
+		first->rebind(blk, first->src());
+
+		offset_ = (dst - data_) + other.offset_;
+	}
+	else
+	{
+		byte* src;
+		size_type i{ n };
+		for (auto& h : other.handles_)
+		{
+			// make_aligned evaluates its alignment twice
+			size_type const a{ align_for(i++, h->align()) };
+			blk = data_ + offset_;
+			src = make_aligned(blk, a);
+
+			h->transfer(blk, src);
+			offset_ += h->size() + (src - blk);
+		}
+	}
+
+	handles_.insert(handles_.end(),
+		std::make_move_iterator(other.handles_.begin()),
+		std::make_move_iterator(other.handles_.end()));
+
+	if (pos != n)
+	{
+		// the objects stay where they are; only the handles move into place
+		std::rotate(handles_.begin() + pos, handles_.begin() + n, handles_.end());
+
+		for (auto& s : sections_)
+		{
+			if (s.handle_index >= n)
+			{
+				s.handle_index = s.handle_index - n + pos;
+			}
+			else if (s.handle_index >= pos)
+			{
+				s.handle_index += m;
+			}
+		}
+		std::sort(sections_.begin(), sections_.end(),
+			[](section const& x, section const& y)
+		{
+			return x.handle_index < y.handle_index;
+		});
+		in_order_ = false;
+	}
+
+	other.handles_.clear();
+	other.sections_.clear();
+	other.offset_ = 0;
+	other.in_order_ = true;
+	GUT_TRACE_RECORD(trace_pair(gut::trace_op::splice, this, &other, pos));
+}
+
+void gut::contiguous_allocator::reordered() noexcept
+{
+	in_order_ = true;
+	for (size_type i{ 1 }, sz{ handles_.size() }; i < sz; ++i)
+	{
+		if (handles_[i]->src() < handles_[i - 1]->src())
+		{
+			in_order_ = false;
+			break;
+		}
+	}
+
+	// sections name the handle they precede by its index from before the
+	// permutation, even if the objects are still in order; their bytes are
+	// recovered by the next compaction
+	sections_.clear();
+}
+
+void gut::contiguous_allocator::compact_in_order()
+{
+	if (in_order_)
+	{
+		return;
+	}
+
+	auto relocated = reallocate(std::max(cap_, packed_bound()));
+
+	counters_.compaction_relocated_bytes += relocated;
+#ifdef GUT_ALLOCATOR_HOOKS
+	notify(compaction_hook, this, cap_, cap_, relocated);
+#endif
+	// only recorded when it did something; erase and compact call it first
+	GUT_TRACE_RECORD(trace(gut::trace_op::compact_in_order, this));
+}
+
+size_type gut::contiguous_allocator::compact(gut::packing const p)
+{
+	auto const used = offset_;
+	size_type relocated;
+
+	if (p == gut::packing::minimize_padding)
+	{
+		// sizes are multiples of alignments, so placing the strictest alignment
+		// first leaves every later object aligned without padding; a stable
+		// counting sort over the power of two alignment classes keeps handle
+		// order within a class
+		constexpr size_type classes{ sizeof(size_type) * 8 };
+		size_type first[classes + 1]{};
+		std::vector<unsigned char> cls(handles_.size());
+
+		for (size_type i{ 0 }, sz{ handles_.size() }; i != sz; ++i)
+		{
+			auto const a = handles_[i]->align();
+			unsigned char c{ 0 };
+			while ((size_type{ 1 } << c) < a)
+			{
+				++c;
+			}
+
+			// descending alignment maps to ascending bucket index
+			cls[i] = static_cast<unsigned char>(classes - 1 - c);
+			++first[cls[i] + 1];
+		}
+
+		for (size_type c{ 0 }; c != classes; ++c)
+		{
+			first[c + 1] += first[c];
+		}
+
+		std::vector<size_type> order(handles_.size());
+		for (size_type i{ 0 }, sz{ handles_.size() }; i != sz; ++i)
+		{
+			order[first[cls[i]]++] = i;
+		}
+
+		// chunk boundaries fall on other elements once the order changes
+		relocated = reallocate(std::max(cap_, packed_bound(order.data())), order.data());
+	}
+	else
+	{
+		relocated = reallocate(std::max(cap_, packed_bound()));
+	}
+
+	counters_.compaction_relocated_bytes += relocated;
+#ifdef GUT_ALLOCATOR_HOOKS
+	notify(compaction_hook, this, cap_, cap_, relocated);
+#endif
+	GUT_TRACE_RECORD(trace(gut::trace_op::compact, this, static_cast<std::uint64_t>(p)));
+
+	return used > offset_ ? used - offset_ : 0;
+}
+
+void gut::contiguous_allocator::set_compaction(gut::compaction const c) noexcept
+{
+	compaction_ = c;
+}
+
+gut::compaction gut::contiguous_allocator::compaction() const noexcept
+{
+	return compaction_;
+}
+
+void gut::contiguous_allocator::set_growth(gut::growth const g) noexcept
+{
+	assert(g.factor >= 1.0);
+	growth_ = g;
+}
+
+gut::growth gut::contiguous_allocator::growth() const noexcept
+{
+	return growth_;
+}
+
+void gut::contiguous_allocator::reserve(size_type const bytes, size_type const count)
+{
+	if (cap_ < bytes)
+	{
+		grow(bytes, 0);
+	}
+	if (handles_.capacity() < count)
+	{
+		handles_.reserve(count);
+	}
+}
+
+size_type gut::contiguous_allocator::compact_step(size_type const byte_budget)
+{
+	if (!in_order_)
+	{
+		return 0;
+	}
+
+	// sections are sorted, so they are visited from the lowest gap up. a gap
+	// that moves nothing was either absorbed as padding or lies in front of an
+	// object that would overlap itself, and the next one is tried
+	size_type relocated{ 0 };
+	for (size_type k{ 0 }; relocated == 0 && k < sections_.size(); )
+	{
+		auto const s = sections_[k];
+		byte* block{ as_byte_ptr(handles_[s.handle_index]->blk()) - s.available_size };
+		relocated = transfer(block, s.handle_index, 0, byte_budget);
+
+		k = std::upper_bound(sections_.begin(), sections_.end(), s.handle_index,
+			[](size_type const idx, section const& x)
+		{
+			return idx < x.handle_index;
+		}) - sections_.begin();
+	}
+
+	counters_.compaction_relocated_bytes += relocated;
+#ifdef GUT_ALLOCATOR_HOOKS
+	if (relocated)
+	{
+		notify(compaction_hook, this, cap_, cap_, relocated);
+	}
+#endif
+	GUT_TRACE_RECORD(trace(gut::trace_op::compact_step, this, byte_budget));
+	return relocated;
 }
 
 void gut::contiguous_allocator::swap(contiguous_allocator& other) noexcept
@@ -137,17 +608,55 @@ void gut::contiguous_allocator::swap(contiguous_allocator& other) noexcept
 	std::swap(data_, other.data_);
 	std::swap(offset_, other.offset_);
 	std::swap(cap_, other.cap_);
+	std::swap(in_order_, other.in_order_);
+	std::swap(placement_, other.placement_);
+	std::swap(compaction_, other.compaction_);
+	std::swap(growth_, other.growth_);
+	std::swap(backing_, other.backing_);
+	std::swap(counters_, other.counters_);
+	GUT_TRACE_RECORD(trace_pair(gut::trace_op::swap, this, &other));
 }
 
 void gut::contiguous_allocator::clear()
 {
-	for (auto& h : handles_)
-	{
-		h->destroy();
-	}
+	destroy_elements(0, handles_.size());
 	sections_.clear();
 	handles_.clear();
 	offset_ = 0;
+	in_order_ = true;
+	GUT_TRACE_RECORD(trace(gut::trace_op::clear, this));
+}
+//////////////////////////////////////////////////////////////////////////////////
+// instrumentation
+//////////////////////////////////////////////////////////////////////////////////
+gut::arena_stats gut::contiguous_allocator::stats() const
+{
+	gut::arena_stats s{};
+
+	for (auto const& h : handles_)
+	{
+		s.bytes_used += h->size();
+		s.padding_bytes += as_byte_ptr(h->src()) - as_byte_ptr(h->blk());
+	}
+
+	// everything below offset_ that no element accounts for; this also covers
+	// holes that are not tracked by a section while the handles are out of order
+	s.gap_bytes = offset_ - s.bytes_used - s.padding_bytes;
+	s.gap_count = sections_.size();
+	s.capacity = cap_;
+	s.handle_table_bytes = handles_.capacity() * sizeof(gut::polymorphic_handle);
+	s.growth_count = counters_.growth_count;
+	s.growth_relocated_bytes = counters_.growth_relocated_bytes;
+	s.compaction_relocated_bytes = counters_.compaction_relocated_bytes;
+
+	return s;
+}
+
+size_type gut::contiguous_allocator::footprint() const noexcept
+{
+	return cap_ +
+		handles_.capacity() * sizeof(gut::polymorphic_handle) +
+		sections_.capacity() * sizeof(section);
 }
 //////////////////////////////////////////////////////////////////////////////////
 // private member functions
@@ -157,123 +666,488 @@ void gut::contiguous_allocator::copy(contiguous_allocator const& other)
 	gut::polymorphic_handle out_h;
 	byte* blk;
 	byte* src;
-	for (auto const& h : other.handles_)
+
+	handles_.reserve(handles_.size() + other.handles_.size());
+
+	auto first = other.handles_.data();
+	auto const last = first + other.handles_.size();
+	while (first != last)
 	{
-		blk = data_ + offset_;
-		src = make_aligned(blk, h->align());
-		h->copy(blk, src, out_h);
-		handles_.emplace_back(std::move(out_h));
-		offset_ += h->size() + (src - blk);
+		auto const& h = *first;
+		size_type const n( h->run_end(first, last) - first );
+
+		// packed, the elements of a run follow each other without padding, so
+		// a run is copied as a whole by one loop over its type
+		if (placement_.chunk == 0)
+		{
+			size_type const align{ h->align() };
+			size_type const run_size{ n * h->size() };
+			blk = data_ + offset_;
+			src = make_aligned(blk, align);
+
+			// packing from a differently aligned base can take more padding
+			// than the source arena did
+			if (src + run_size > data_ + cap_)
+			{
+				grow(next_capacity(run_size + align), run_size + align - 1);
+				blk = data_ + offset_;
+				src = make_aligned(blk, align);
+			}
+
+			h->copy_run(first, n, blk, src, handles_);
+			offset_ += run_size + (src - blk);
+			first += n;
+			continue;
+		}
+
+		for (auto const run_last = first + n; first != run_last; ++first)
+		{
+			size_type const align{ align_for(handles_.size(), (*first)->align()) };
+			blk = data_ + offset_;
+			src = make_aligned(blk, align);
+
+			if (src + (*first)->size() > data_ + cap_)
+			{
+				grow(next_capacity((*first)->size() + align), (*first)->size() + align - 1);
+				blk = data_ + offset_;
+				src = make_aligned(blk, align);
+			}
+
+			(*first)->copy(blk, src, out_h);
+			handles_.emplace_back(std::move(out_h));
+			offset_ += (*first)->size() + (src - blk);
+		}
 	}
 }
 
-byte* gut::contiguous_allocator::destroy(size_type i, size_type const j)
+byte* gut::contiguous_allocator::destroy(size_type const i, size_type const j)
 {
-	auto& h_i = handles_[i++];
-
-	auto block_address = as_byte_ptr(h_i->blk());
-
-	// merge left adjacent section - maybe switch to iterator?
 	auto l_sec = to_section_index(i);
+	auto block_address = as_byte_ptr(handles_[i]->blk());
+
+	// merge left adjacent section
 	if (l_sec != sections_.size())
 	{
 		block_address -= sections_[l_sec].available_size;
 		sections_.erase(sections_.begin() + l_sec);
 	}
 
-	h_i->destroy();
+	destroy_elements(i, j);
+	return block_address;
+}
 
-	for (; i != j; ++i)
+void gut::contiguous_allocator::destroy_elements(size_type const i, size_type const j)
+{
+	auto first = handles_.data() + i;
+	auto const last = handles_.data() + j;
+	while (first != last)
 	{
-		handles_[i]->destroy();
+		first = (*first)->destroy_run(first, last);
 	}
-
-	return block_address;
 }
 
 void gut::contiguous_allocator::erase_inner_sections(size_type const i, size_type const j)
 {
-	if (sections_.empty())
+	// gaps in front of handles i + 1 .. j - 1 lie inside the erased range
+	sections_.erase(std::remove_if(sections_.begin(), sections_.end(),
+		[i, j](section const& s)
 	{
-		return;
+		return i < s.handle_index && s.handle_index < j;
+	}), sections_.end());
+}
+
+size_type gut::contiguous_allocator::to_section_index(size_type const handle_index) const
+{
+	// incremental compaction can leave many sections; they are sorted
+	auto it = std::lower_bound(sections_.begin(), sections_.end(), handle_index,
+		[](section const& s, size_type const idx)
+	{
+		return s.handle_index < idx;
+	});
+	return it != sections_.end() && it->handle_index == handle_index
+		? size_type(it - sections_.begin())
+		: sections_.size();
+}
+
+byte* gut::contiguous_allocator::replace_block(size_type const i, size_type const size,
+	size_type const align, byte*& src)
+{
+	assert(i < handles_.size());
+
+	auto& h = handles_[i];
+	auto const blk = as_byte_ptr(h->blk());
+	auto const end = as_byte_ptr(h->src()) + h->size();
+	size_type const a{ align_for(i, align) };
+
+	// the bytes the new object may take without moving anything else: up to
+	// the next block in order, to the capacity behind the last element, or
+	// else just the old block
+	bool const last{ end == data_ + offset_ };
+	bool const next_known{ !last && in_order_ && i + 1 < handles_.size() };
+	byte* const limit
+	{
+		last ? data_ + cap_ :
+		next_known ? as_byte_ptr(handles_[i + 1]->blk()) :
+		end
+	};
+
+	// the gap in front is only taken when the block alone is too small
+	auto sec = to_section_index(i);
+	byte* first{ blk };
+	src = make_aligned(first, a);
+	if (src + size > limit && sec != sections_.size())
+	{
+		first = blk - sections_[sec].available_size;
+		src = make_aligned(first, a);
+	}
+
+	if (src + size <= limit)
+	{
+		h->destroy();
+
+		if (first != blk)
+		{
+			sections_.erase(sections_.begin() + sec);
+		}
+
+		if (last)
+		{
+			offset_ = (src + size) - data_;
+		}
+		else if (next_known)
+		{
+			// what is left up to the next block becomes its gap
+			size_type const slack = limit - (src + size);
+			auto next = to_section_index(i + 1);
+			if (next != sections_.size())
+			{
+				sections_[next].available_size = slack;
+				if (slack == 0)
+				{
+					sections_.erase(sections_.begin() + next);
+				}
+			}
+			else if (slack != 0)
+			{
+				insert_section(i + 1, slack);
+			}
+		}
+		return first;
 	}
 
-	auto b = sections_.cbegin();
-	auto e = sections_.cend();
+	byte* nblk{ data_ + offset_ };
+	src = make_aligned(nblk, a);
+	if (cap_ - offset_ < size + (src - nblk))
+	{
+		// growth moves every element, the old one included, so the search
+		// starts over; afterwards there is room behind the last element
+		grow(next_capacity(size + (src - nblk)), size + a - 1);
+		return replace_block(i, size, align, src);
+	}
 
-	for (; b != e && b->handle_index <= i; ++b);
+	// too big for its place: built behind the last element, which moves no
+	// other element. the old block and the gap in front of it become the gap
+	// of the next block in order, or an untracked hole until the next
+	// compaction if that is unknown
+	h->destroy();
 
-	for (--e; e != b; --e)
+	byte* gap{ blk };
+	if (sec != sections_.size())
 	{
-		if (e->handle_index < j)
+		gap -= sections_[sec].available_size;
+		sections_.erase(sections_.begin() + sec);
+	}
+	if (next_known)
+	{
+		auto next = to_section_index(i + 1);
+		size_type const available = as_byte_ptr(handles_[i + 1]->blk()) - gap;
+		if (next != sections_.size())
 		{
-			++e;
-			break;
+			sections_[next].available_size = available;
 		}
-		else if (e->handle_index == j)
+		else
 		{
-			break;
+			insert_section(i + 1, available);
 		}
 	}
 
-	sections_.erase(b, e);
+	offset_ += size + (src - nblk);
+	in_order_ = false;
+	return nblk;
 }
 
-size_type gut::contiguous_allocator::to_section_index(size_type const handle_index) const
+size_type gut::contiguous_allocator::reallocate(size_type const ncap, size_type const* order)
 {
-	auto sz{ sections_.size() };
-	for (size_type i{ 0 }; i != sz; ++i)
+	byte* ndata = as_byte_ptr(backing_.allocate(ncap));
+
+	if (ndata)
 	{
-		if (sections_[i].handle_index == handle_index)
+		size_type const old_cap{ cap_ };
+		sections_.clear();
+		offset_ = 0;
+		cap_ = ncap;
+
+		size_type relocated{ 0 };
+		byte* blk;
+		byte* src;
+		for (size_type i{ 0 }, sz{ handles_.size() }; i != sz; ++i)
+		{
+			size_type const idx{ order ? order[i] : i };
+			gut::polymorphic_handle& h{ handles_[idx] };
+			blk = ndata + offset_;
+			src = make_aligned(blk, align_for(idx, h->align()));
+
+			h->transfer(blk, src);
+			offset_ += h->size() + (src - blk);
+			relocated += h->size();
+		}
+
+		backing_.deallocate(data_, old_cap);
+		data_ = ndata;
+
+		if (order)
 		{
-			return i;
+			reordered();
 		}
+		else
+		{
+			in_order_ = true;
+		}
+		return relocated;
+	}
+	else
+	{
+		throw std::bad_alloc{};
 	}
-	return sz;
 }
 
-void gut::contiguous_allocator::transfer(byte* block, size_type i, size_type const j)
+size_type gut::contiguous_allocator::reallocate_block(size_type const ncap, size_type const align)
 {
-	size_type offset = 0;
+	byte* ndata = as_byte_ptr(backing_.allocate(ncap));
 
-	for (byte* blk, *src; i != j; ++i)
+	if (!ndata)
 	{
-		blk = block + offset;
-		src = make_aligned(blk, handles_[i]->align());
+		throw std::bad_alloc{};
+	}
+
+	byte* dst{ ndata + ((data_ - ndata) & (align - 1)) };
+	std::memcpy(dst, data_, offset_);
+
+	// the handles only hold pointers into the arena, so they all move by the
+	// same delta; the physically first element also takes the bytes in front
+	// of dst as padding
+	auto& first = handles_.front();
+	bool const leading{ in_order_ && as_byte_ptr(first->blk()) == data_ };
+
+	std::ptrdiff_t const delta{ dst - data_ };
+	for (auto& h : handles_)
+	{
+		h->rebind(as_byte_ptr(h->blk()) + delta, as_byte_ptr(h->src()) + delta);
+	}
+	if (leading)
+	{
+		first->rebind(ndata, first->src());
+	}
+
+	size_type const copied{ offset_ };
+	backing_.deallocate(data_, cap_);
+	data_ = ndata;
+	offset_ += dst - ndata;
+	cap_ = ncap;
+
+	return copied;
+}
+
+void gut::contiguous_allocator::grow(size_type const ncap, size_type const extra)
+{
+	// the new block may be aligned differently from the old one, so the
+	// elements can need more padding than they had
+	auto const old_cap = cap_;
+
+	bool trivially_relocatable{ true };
+	size_type align{ 1 };
+	for (size_type i{ 0 }, sz{ handles_.size() }; i != sz && trivially_relocatable; ++i)
+	{
+		auto const& h = handles_[i];
+		trivially_relocatable = h->is_trivially_relocatable();
+		align = std::max(align, align_for(i, h->align()));
+	}
+
+	// with nothing to move element by element, growing is a single copy of
+	// the arena; the placement of every element stays as it is
+	auto const relocated = trivially_relocatable && !handles_.empty()
+		? reallocate_block(std::max(ncap, offset_ + align - 1 + extra), align)
+		: reallocate(std::max(ncap, packed_bound() + extra));
+
+	// keep room for as many handles as elements of the average size held
+	// would fit into the new arena
+	if (growth_.kind == gut::growth::strategy::adaptive)
+	{
+		reserve_handles(0);
+	}
+
+	++counters_.growth_count;
+	counters_.growth_relocated_bytes += relocated;
+#ifdef GUT_ALLOCATOR_HOOKS
+	notify(growth_hook, this, old_cap, cap_, relocated);
+#else
+	(void)old_cap;
+#endif
+}
+
+size_type gut::contiguous_allocator::next_capacity(size_type const required) const noexcept
+{
+	size_type const min_cap{ cap_ + required };
 
-		if (src + handles_[i]->size() <= handles_[i]->src())
+	switch (growth_.kind)
+	{
+	case gut::growth::strategy::additive:
+		return cap_ + std::max(required, growth_.bytes);
+	case gut::growth::strategy::reserve:
+		if (cap_ < growth_.bytes)
 		{
-			handles_[i]->transfer(blk, src);
-			offset += handles_[i]->size() + (src - blk);
+			return std::max(min_cap, growth_.bytes);
 		}
-		else if ( i != 0 )
+		return scale(min_cap, growth_.factor);
+	default:
+		return scale(min_cap, growth_.factor);
+	}
+}
+
+size_type gut::contiguous_allocator::next_handle_capacity(size_type const required) const noexcept
+{
+	size_type const n{ handles_.size() };
+	size_type const min_count{ n + required };
+
+	switch (growth_.kind)
+	{
+	case gut::growth::strategy::additive:
+		return n + std::max(required, growth_.handles);
+	case gut::growth::strategy::adaptive:
+		if (n != 0 && offset_ != 0)
 		{
-			sections_.emplace_back(i, blk - data_);
-			return;
+			// the elements held predict how many fit into the whole arena
+			size_type const predicted{ static_cast<size_type>(
+				static_cast<double>(cap_) * static_cast<double>(n) / static_cast<double>(offset_)) };
+			return std::max(min_count, std::max(predicted, scale(n, growth_.factor)));
 		}
+		return std::max(min_count, scale(n, growth_.factor));
+	default:
+		return std::max(min_count, scale(n, growth_.factor));
 	}
+}
 
-	if (j != handles_.size())
+void gut::contiguous_allocator::reserve_handles(size_type const required)
+{
+	size_type const ncount{ next_handle_capacity(required) };
+	if (ncount > handles_.capacity())
 	{
-		transfer(block + offset, j, next_section(j));
+		handles_.reserve(ncount);
 	}
-	else
+}
+
+size_type gut::contiguous_allocator::packed_bound(size_type const* order) const
+{
+	// every backing returns blocks aligned for std::max_align_t, so the
+	// padding in front of an element aligned no stricter than that is known
+	// exactly; only over-aligned elements are charged align - 1
+	constexpr size_type base_align{ alignof(std::max_align_t) };
+
+	size_type bound{ 0 };
+	for (size_type i{ 0 }, sz{ handles_.size() }; i != sz; ++i)
 	{
-		auto& last_handle = handles_.back();
-		offset_ = (as_byte_ptr(last_handle->src()) + last_handle->size()) - data_;
+		size_type const idx{ order ? order[i] : i };
+		size_type const align{ align_for(idx, handles_[idx]->align()) };
+		bound = align <= base_align
+			? (bound + align - 1) & ~(align - 1)
+			: bound + align - 1;
+		bound += handles_[idx]->size();
 	}
+	return bound;
 }
 
-size_type gut::contiguous_allocator::next_section(size_type const handle_index) const
+size_type gut::contiguous_allocator::transfer(byte* block, size_type i, size_type const shift,
+	size_type const budget)
 {
-	for (auto s : sections_)
+	size_type relocated{ 0 };
+
+	// elements keep their placement only if their chunk boundaries do not move
+	bool const placement_kept{ placement_.chunk == 0 || shift % placement_.chunk == 0 };
+
+	for (size_type const sz{ handles_.size() }; i != sz; ++i)
 	{
-		if (handle_index < s.handle_index)
+		auto& h = handles_[i];
+
+		// a gap in front of this element joins the free space being closed
+		auto sec = to_section_index(i);
+		if (sec != sections_.size())
 		{
-			return s.handle_index;
+			sections_.erase(sections_.begin() + sec);
 		}
+
+		auto old_src = as_byte_ptr(h->src());
+		auto src = make_aligned(block, align_for(i - shift, h->align()));
+
+		// an element that would have to move right to reach its new chunk
+		// boundary stays where it is
+		if (src > old_src)
+		{
+			src = old_src;
+		}
+
+		if (src == old_src)
+		{
+			// nothing left to close; the free bytes become padding of this block
+			h->rebind(block, src);
+
+			if (placement_kept)
+			{
+				return relocated;
+			}
+		}
+		else if (relocated >= budget)
+		{
+			// out of budget; the rest of the gap waits for the next step
+			insert_section(i, size_type(as_byte_ptr(h->blk()) - block));
+			return relocated;
+		}
+		else if (h->is_trivially_relocatable() || src + h->size() <= old_src)
+		{
+			if (h->is_trivially_relocatable())
+			{
+				std::memmove(src, old_src, h->size());
+				h->rebind(block, src);
+			}
+			else
+			{
+				h->transfer(block, src);
+			}
+			relocated += h->size();
+		}
+		else
+		{
+			// moving would overlap the object with itself; keep the free bytes
+			// as a section in front of it
+			insert_section(i, size_type(as_byte_ptr(h->blk()) - block));
+			return relocated;
+		}
+
+		block = src + h->size();
 	}
-	return handles_.size();
+
+	offset_ = block - data_;
+	return relocated;
+}
+
+void gut::contiguous_allocator::insert_section(size_type const handle_index,
+	size_type const available_size)
+{
+	section s{ handle_index, available_size };
+	sections_.insert(std::lower_bound(sections_.begin(), sections_.end(), s,
+		[](section const& x, section const& y)
+	{
+		return x.handle_index < y.handle_index;
+	}), s);
 }
 
 void swap(gut::contiguous_allocator& x, gut::contiguous_allocator& y)
@@ -1,14 +1,149 @@
 #ifndef GUT_CONTIGUOUS_ALLOCATOR_H
 #define GUT_CONTIGUOUS_ALLOCATOR_H
 
+#include "arena_backing.h"
+#include "handle.h"
 #include "polymorphic_handle.h"
+#include "relocation_traits.h"
+#include "trace.h"
 #include <cstddef>
+#include <typeinfo>
 #include <vector>
 
 namespace gut
 {
 	class polymorphic_handle;
-	template<class B> class polymorphic_vector;
+	template<class B, class... Ds> class polymorphic_vector;
+
+	// snapshot of how the bytes of a contiguous_allocator are spent
+	struct arena_stats
+	{
+		std::size_t bytes_used;            // object bytes of live elements
+		std::size_t padding_bytes;         // alignment padding in front of elements
+		std::size_t gap_bytes;             // bytes in sections left by erase
+		std::size_t gap_count;
+		std::size_t capacity;
+		std::size_t handle_table_bytes;    // capacity of the handle table
+		std::size_t growth_count;
+		std::size_t growth_relocated_bytes;
+		std::size_t compaction_relocated_bytes;
+	};
+
+	// a fixed value: std::hardware_destructive_interference_size follows
+	// -mtune, so it may differ between translation units and is not part of a
+	// stable ABI. define GUT_DESTRUCTIVE_INTERFERENCE_SIZE for other targets
+#ifndef GUT_DESTRUCTIVE_INTERFERENCE_SIZE
+#define GUT_DESTRUCTIVE_INTERFERENCE_SIZE 64
+#endif
+	constexpr std::size_t destructive_interference_size{ GUT_DESTRUCTIVE_INTERFERENCE_SIZE };
+
+	// where elements start in the arena. threads mutating neighbouring
+	// elements do not contend for a cache line when each of them, or each
+	// chunk a thread works on, starts on a line of its own.
+	struct placement
+	{
+		// every chunk-th element (by index) starts on a destructive interference
+		// boundary; 0 packs elements as tightly as their alignment allows
+		std::size_t chunk;
+
+		static constexpr placement packed() noexcept
+		{
+			return{ 0 };
+		}
+
+		static constexpr placement per_element() noexcept
+		{
+			return{ 1 };
+		}
+
+		static constexpr placement per_chunk(std::size_t const n) noexcept
+		{
+			return{ n };
+		}
+	};
+
+	// physical placement used when an arena is rewritten by compact()
+	enum class packing
+	{
+		// objects follow handle order, as after growth
+		in_order,
+		// objects are grouped by decreasing alignment so that no padding is
+		// needed between them; handle order is kept, memory order is not
+		minimize_padding
+	};
+
+	// when the gap left by an erase is closed
+	enum class compaction
+	{
+		// erase relocates the elements behind the gap right away
+		eager,
+		// erase only records the gap; compact_step() closes gaps a bounded
+		// number of bytes at a time
+		incremental
+	};
+
+	// how much an arena and its handle table grow once they are full
+	struct growth
+	{
+		enum class strategy
+		{
+			// capacity times factor; factor 2 is the classic doubling
+			geometric,
+			// bytes more arena and handles more handles each time
+			additive,
+			// the first growth jumps to bytes, later ones double; the pages of
+			// the reservation are only committed once elements are written to
+			// them, as with any mapped backing or large heap block
+			reserve,
+			// the arena grows geometrically and the handle table is sized from
+			// the average bytes per element held, so the two stay in step
+			adaptive
+		};
+
+		strategy kind;
+		double factor;
+		std::size_t bytes;
+		std::size_t handles;
+
+		static constexpr growth geometric(double const factor = 2.0) noexcept
+		{
+			return{ strategy::geometric, factor, 0, 0 };
+		}
+
+		static constexpr growth additive(std::size_t const bytes, std::size_t const handles) noexcept
+		{
+			return{ strategy::additive, 1.0, bytes, handles };
+		}
+
+		static constexpr growth reserve(std::size_t const bytes) noexcept
+		{
+			return{ strategy::reserve, 2.0, bytes, 0 };
+		}
+
+		static constexpr growth adaptive(double const factor = 2.0) noexcept
+		{
+			return{ strategy::adaptive, factor, 0, 0 };
+		}
+	};
+
+#ifdef GUT_ALLOCATOR_HOOKS
+	class contiguous_allocator;
+
+	struct allocator_event
+	{
+		contiguous_allocator const* allocator;
+		std::size_t old_capacity;
+		std::size_t new_capacity;
+		std::size_t relocated_bytes;
+	};
+
+	using allocator_hook = void(*)(allocator_event const&);
+
+	// process wide callbacks, run after an arena grew or relocated elements to
+	// close gaps; null disables a hook
+	void set_growth_hook(allocator_hook hook) noexcept;
+	void set_compaction_hook(allocator_hook hook) noexcept;
+#endif
 
 	class contiguous_allocator
 	{
@@ -18,7 +153,9 @@ namespace gut
 
 		~contiguous_allocator() noexcept;
 
-		explicit contiguous_allocator(size_type const cap = 0);
+		explicit contiguous_allocator(size_type const cap = 0,
+			gut::placement const p = gut::placement::packed(),
+			gut::arena_backing const b = gut::arena_backing::heap());
 
 		contiguous_allocator(contiguous_allocator&& other) noexcept;
 		contiguous_allocator& operator=(contiguous_allocator&& other) noexcept;
@@ -30,11 +167,61 @@ namespace gut
 		T* allocate();
 
 		void deallocate(size_type const i, size_type const j);
+		void deallocate_back();
+
+		// destroys the element of handle i and returns room for a T that takes
+		// over the handle index; see replace_block(). handle i refers to the T
+		// before it is constructed, so a failed construction must abandon(i)
+		template<class T>
+		T* replace(size_type const i);
+
+		// drops handle i, whose object was never constructed, and gives its
+		// block back to the arena
+		void abandon(size_type const i);
+
+		// moves every element of other into this arena and inserts their handles
+		// at handle index pos; other is left empty but keeps its storage
+		void splice(size_type const pos, contiguous_allocator&& other);
+
+		// to be called after the handles were permuted; detects whether they
+		// still follow the physical order of the objects
+		void reordered() noexcept;
+
+		// relocates the objects into handle order if they are not already
+		void compact_in_order();
+
+		// rewrites the whole arena, closing every gap, and returns the number of
+		// bytes reclaimed; the placement lasts until the next growth or erase
+		size_type compact(gut::packing const p);
+
+		void set_compaction(gut::compaction const c) noexcept;
+		gut::compaction compaction() const noexcept;
+
+		void set_growth(gut::growth const g) noexcept;
+		gut::growth growth() const noexcept;
+
+		// makes the arena at least bytes and the handle table at least count
+		// elements large; counts as growth if the arena is reallocated
+		void reserve(size_type const bytes, size_type const count);
+
+		// closes the lowest gap by relocating elements into it until at least
+		// byte_budget bytes were moved or the gap is gone, and returns the
+		// number of bytes moved; 0 once no gap can be closed in place. does
+		// nothing while the handles are out of order
+		size_type compact_step(size_type const byte_budget);
 
 		void swap(contiguous_allocator& other) noexcept;
 		void clear();
 
+		gut::arena_stats stats() const;
+
+		// bytes held by the arena, the handle table and the section list, in
+		// constant time
+		size_type footprint() const noexcept;
+
 	public:
+		// available_size free bytes right in front of the block of handle_index;
+		// kept sorted by handle_index
 		struct section
 		{
 			section(size_type const idx, size_type const sz) noexcept
@@ -50,72 +237,146 @@ namespace gut
 
 		void erase_inner_sections(size_type const i, size_type const j);
 
-		byte* destroy(size_type i, size_type const j);
+		byte* destroy(size_type const i, size_type const j);
 
-		size_type to_section_index(size_type const handle_index) const;
+		// destroys the elements of handles [i, j) a run of one type at a time;
+		// runs of trivially destructible types only cost a look at their handles
+		void destroy_elements(size_type const i, size_type const j);
 
-		size_type next_section(size_type const handle_index) const;
+		size_type to_section_index(size_type const handle_index) const;
 
-		void transfer(byte* block, size_type i, size_type const j);
+		// destroys the element of handle i and finds size bytes aligned to align
+		// for its successor: in the old block if they fit there with its
+		// padding and the gaps around it, else behind the last element, which
+		// takes the handles out of physical order. returns the new block; the
+		// object goes to src
+		byte* replace_block(size_type const i, size_type const size,
+			size_type const align, byte*& src);
+
+		// packs the elements from handle i onwards into block, closing every gap
+		// on the way, and returns the number of object bytes moved; shift is the
+		// number of handles about to be erased in front of i. once budget bytes
+		// were moved the rest of the gap is left as a section
+		size_type transfer(byte* block, size_type i, size_type const shift,
+			size_type const budget = size_type(-1));
+
+		void insert_section(size_type const handle_index, size_type const available_size);
+
+		// relocates every element into a new block of ncap bytes, in handle
+		// order or in the given order of handle indices, and returns the number
+		// of object bytes moved
+		size_type reallocate(size_type const ncap, size_type const* order = nullptr);
+
+		// copies the used bytes into a new block of ncap bytes with one memcpy,
+		// at an address congruent to data_ modulo align, and rebinds every
+		// handle; gaps and element order are kept. only valid when every element
+		// is trivially relocatable and placed with an alignment dividing align
+		size_type reallocate_block(size_type const ncap, size_type const align);
+
+		// reallocates into at least ncap bytes, leaving room for extra more bytes
+		// behind the relocated elements whatever their new padding
+		void grow(size_type const ncap, size_type const extra);
+
+		// the capacities the growth policy asks for once required more bytes or
+		// handles no longer fit
+		size_type next_capacity(size_type const required) const noexcept;
+		size_type next_handle_capacity(size_type const required) const noexcept;
+
+		void reserve_handles(size_type const required);
+
+		// the alignment the element at handle index i is placed with
+		size_type align_for(size_type const i, size_type const align) const noexcept;
+
+		// an upper bound of the bytes needed to pack every element in handle
+		// order, or in the given order of handle indices
+		size_type packed_bound(size_type const* order = nullptr) const;
+
+		struct counters
+		{
+			size_type growth_count;
+			size_type growth_relocated_bytes;
+			size_type compaction_relocated_bytes;
+		};
 
 		std::vector<section> sections_;
 		std::vector<gut::polymorphic_handle> handles_;
 		byte* data_;
 		size_type offset_;
 		size_type cap_;
+
+		// false when the handles are not in the physical order of their objects,
+		// as after a splice into the middle; offset_ then still marks the end
+		// of the used bytes, and the order is restored before compacting
+		bool in_order_;
+
+		gut::placement placement_;
+		gut::compaction compaction_;
+		gut::growth growth_;
+
+		// owns data_; it stays with the arena on copy assignment and travels
+		// with it on move and swap
+		gut::arena_backing backing_;
+		counters counters_;
 	};
 }
 
 #define make_aligned(block, align)\
 (byte*)(((std::uintptr_t)block + align - 1) & ~(align - 1))
 
+inline gut::contiguous_allocator::size_type
+gut::contiguous_allocator::align_for(size_type const i, size_type const align) const noexcept
+{
+	return placement_.chunk != 0 && i % placement_.chunk == 0 && align < gut::destructive_interference_size
+		? gut::destructive_interference_size
+		: align;
+}
+
 template<class T>
 T* gut::contiguous_allocator::allocate()
 {
+	size_type const align = align_for(handles_.size(), alignof(T));
+
 	byte* blk = data_ + offset_;
-	byte* src = make_aligned(blk, alignof(T));
+	byte* src = make_aligned(blk, align);
 
 	size_type available_size = cap_ - offset_;
 	size_type required_size = sizeof(T) + (src - blk);
 
 	if (available_size < required_size)
 	{
-		size_type ncap = (cap_ + required_size) * 2;
-		byte* ndata = reinterpret_cast<byte*>(std::malloc(ncap));
+		grow(next_capacity(required_size), sizeof(T) + align - 1);
 
-		if (ndata)
-		{
-			sections_.clear();
-			offset_ = 0;
-			cap_ = ncap;
-
-			for (gut::polymorphic_handle& h : handles_)
-			{
-				blk = ndata + offset_;
-				src = make_aligned(blk, h->align());
-
-				h->transfer(blk, src);
-				offset_ += h->size() + (src - blk);
-			}
-
-			blk = ndata + offset_;
-			src = make_aligned(blk, alignof(T));
+		blk = data_ + offset_;
+		src = make_aligned(blk, align);
+	}
 
-			std::free(data_);
-			data_ = ndata;
-		}
-		else
-		{
-			throw std::bad_alloc{};
-		}
+	if (handles_.size() == handles_.capacity())
+	{
+		reserve_handles(1);
 	}
 
 	handles_.emplace_back(gut::handle<T>{ blk, src });
 	offset_ += sizeof(T) + (src - blk);
 
+	GUT_TRACE_RECORD(trace_emplace(this, typeid(T), sizeof(T), alignof(T),
+		gut::is_trivially_relocatable<T>::value));
+
 	return reinterpret_cast<T*>( src );
 }
 
+template<class T>
+T* gut::contiguous_allocator::replace(size_type const i)
+{
+	byte* src;
+	byte* blk = replace_block(i, sizeof(T), alignof(T), src);
+	handles_[i] = gut::polymorphic_handle{ gut::handle<T>{ blk, src } };
+
+	GUT_TRACE_RECORD(trace_replace(this, i, typeid(T), sizeof(T), alignof(T),
+		gut::is_trivially_relocatable<T>::value));
+
+	return reinterpret_cast<T*>(src);
+}
+
 void swap(gut::contiguous_allocator& x, gut::contiguous_allocator& y)
 noexcept(noexcept(x.swap(y)));
 
@@ -0,0 +1,349 @@
+#ifndef GUT_DOUBLE_BUFFER_H
+#define GUT_DOUBLE_BUFFER_H
+
+#include "polymorphic_vector.h"
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <new>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace gut
+{
+	// the size and alignment of an element; all a parallel transform needs to
+	// know about an element before it is built
+	struct element_shape
+	{
+		std::size_t size;
+		std::size_t align;
+
+		template<class D>
+		static constexpr element_shape of() noexcept
+		{
+			return{ sizeof(D), alignof(D) };
+		}
+	};
+
+	// the place a parallel transform prepared for one element; build must
+	// emplace exactly one D there, of the shape given for the same source
+	template<class B>
+	class element_slot
+	{
+	public:
+		template<class D, class... Args, gut::enable_if_derived_t<B, D> = 0>
+		D& emplace(Args&&... args);
+
+	private:
+		friend class gut::transform_plan<B>;
+
+		using byte = gut::contiguous_allocator::byte;
+
+		element_slot(byte* blk, byte* src, gut::element_shape const shape,
+			gut::polymorphic_handle& out) noexcept
+			: blk_{ blk }
+			, src_{ src }
+			, shape_(shape)
+			, out_{ &out }
+		{}
+
+		byte* blk_;
+		byte* src_;
+		gut::element_shape shape_;
+		gut::polymorphic_handle* out_;
+	};
+
+	// builds a polymorphic_vector<B> from another polymorphic_vector in the
+	// arena and handle table the destination already has. the layouts of the
+	// parallel form are kept between calls, so once the capacities have
+	// settled a transform allocates nothing but its threads
+	template<class B>
+	class transform_plan
+	{
+	public:
+		using byte = gut::contiguous_allocator::byte;
+		using size_type = gut::contiguous_allocator::size_type;
+
+		// clears dst, keeping its storage, makes room for about the bytes and
+		// elements of src and calls f(x, dst) for every element x of src; f
+		// emplaces any number of elements into dst
+		template<class S, class F>
+		static void run(gut::polymorphic_vector<S> const& src, gut::polymorphic_vector<B>& dst, F&& f);
+
+		// builds one element of dst for every element x of src. shape(x) gives
+		// the gut::element_shape x turns into; once every element is placed,
+		// build(x, slot) constructs it with slot.emplace<D>(args...). both passes
+		// run on thread_count threads, so neither function may throw
+		template<class S, class Shape, class Build>
+		void run(gut::polymorphic_vector<S> const& src, gut::polymorphic_vector<B>& dst,
+			Shape&& shape, Build&& build,
+			size_type thread_count = std::thread::hardware_concurrency());
+
+	private:
+		struct layout
+		{
+			gut::element_shape shape;
+			byte* block;
+			byte* start;
+		};
+
+		// calls f(first, last) for thread_count contiguous ranges of [0, n)
+		template<class F>
+		static void for_each_range(size_type const thread_count, size_type const n, F&& f);
+
+		std::vector<layout> layouts_;
+	};
+
+	template<class S, class B, class F>
+	void transform_into(gut::polymorphic_vector<S> const& src, gut::polymorphic_vector<B>& dst, F&& f);
+
+	// the parallel form runs a transform_plan<B> made for this call alone, so
+	// its layouts are allocated every time; a transform_plan kept by the
+	// caller, or double_buffer::advance(), reuses them
+	template<class S, class B, class Shape, class Build>
+	void transform_into(gut::polymorphic_vector<S> const& src, gut::polymorphic_vector<B>& dst,
+		Shape&& shape, Build&& build,
+		std::size_t const thread_count = std::thread::hardware_concurrency());
+
+	// two generations of a polymorphic_vector<B>: every tick builds the next
+	// one from current() into the storage of previous() and makes it current,
+	// so that steady state ticks reuse the same two arenas
+	template<class B>
+	class double_buffer
+	{
+	public:
+		using vector_type = gut::polymorphic_vector<B>;
+		using size_type = typename vector_type::size_type;
+
+		explicit double_buffer(size_type const capacity = 0,
+			gut::placement const p = gut::placement::packed(),
+			gut::arena_backing const b = gut::arena_backing::heap());
+
+		vector_type& current() noexcept;
+		vector_type const& current() const noexcept;
+
+		// the generation before current(); it lives until the next advance()
+		vector_type& previous() noexcept;
+		vector_type const& previous() const noexcept;
+
+		// transform_into(current(), previous(), ...), then the roles swap
+		template<class F>
+		void advance(F&& f);
+
+		template<class Shape, class Build>
+		void advance(Shape&& shape, Build&& build,
+			size_type const thread_count = std::thread::hardware_concurrency());
+
+	private:
+		vector_type buffers_[2];
+		unsigned current_;
+		gut::transform_plan<B> plan_;
+	};
+}
+//////////////////////////////////////////////////////////////////////////////////
+// element_slot
+//////////////////////////////////////////////////////////////////////////////////
+template<class B>
+template<class D, class... Args, gut::enable_if_derived_t<B, D>>
+inline D& gut::element_slot<B>::emplace(Args&&... args)
+{
+	assert(out_ != nullptr);
+	assert(sizeof(D) == shape_.size && alignof(D) == shape_.align);
+
+	D* p{ ::new (src_) D{ std::forward<Args>(args)... } };
+	*out_ = gut::polymorphic_handle{ gut::handle<D>{ blk_, p } };
+	out_ = nullptr;
+	return *p;
+}
+//////////////////////////////////////////////////////////////////////////////////
+// transform_plan
+//////////////////////////////////////////////////////////////////////////////////
+template<class B>
+template<class S, class F>
+void gut::transform_plan<B>::run(gut::polymorphic_vector<S> const& src,
+	gut::polymorphic_vector<B>& dst, F&& f)
+{
+	assert(static_cast<void const*>(&src) != static_cast<void const*>(&dst));
+
+	dst.clear();
+	dst.alloc_.reserve(src.alloc_.offset_, src.alloc_.handles_.size());
+
+	for (auto const& x : src)
+	{
+		f(x, dst);
+	}
+}
+
+template<class B>
+template<class S, class Shape, class Build>
+void gut::transform_plan<B>::run(gut::polymorphic_vector<S> const& src,
+	gut::polymorphic_vector<B>& dst, Shape&& shape, Build&& build, size_type thread_count)
+{
+	assert(static_cast<void const*>(&src) != static_cast<void const*>(&dst));
+
+	auto& alloc = dst.alloc_;
+	size_type const n{ src.size() };
+
+	dst.clear();
+	layouts_.resize(n);
+
+	for_each_range(thread_count, n, [&](size_type const first, size_type const last)
+	{
+		for (size_type i{ first }; i != last; ++i)
+		{
+			layouts_[i].shape = shape(src[i]);
+		}
+	});
+
+	// as packed_bound(): blocks are aligned for std::max_align_t, so only
+	// over-aligned elements are charged align - 1
+	constexpr size_type base_align{ alignof(std::max_align_t) };
+
+	size_type bound{ 0 };
+	for (size_type i{ 0 }; i != n; ++i)
+	{
+		size_type const align{ alloc.align_for(i, layouts_[i].shape.align) };
+		bound = align <= base_align
+			? (bound + align - 1) & ~(align - 1)
+			: bound + align - 1;
+		bound += layouts_[i].shape.size;
+	}
+
+	if (alloc.cap_ < bound)
+	{
+		alloc.reserve(alloc.next_capacity(bound - alloc.cap_), 0);
+	}
+	if (alloc.handles_.capacity() < n)
+	{
+		alloc.reserve_handles(n);
+	}
+
+	byte* blk{ alloc.data_ };
+	for (size_type i{ 0 }; i != n; ++i)
+	{
+		auto& l = layouts_[i];
+		l.block = blk;
+		l.start = make_aligned(blk, alloc.align_for(i, l.shape.align));
+		blk = l.start + l.shape.size;
+	}
+
+	alloc.handles_.resize(n);
+
+	for_each_range(thread_count, n, [&](size_type const first, size_type const last)
+	{
+		for (size_type i{ first }; i != last; ++i)
+		{
+			auto const& l = layouts_[i];
+			gut::element_slot<B> slot{ l.block, l.start, l.shape, alloc.handles_[i] };
+			build(src[i], slot);
+			assert(slot.out_ == nullptr);
+		}
+	});
+
+	alloc.offset_ = blk - alloc.data_;
+}
+
+template<class B>
+template<class F>
+void gut::transform_plan<B>::for_each_range(size_type const thread_count, size_type const n, F&& f)
+{
+	size_type const workers{ std::min(std::max(thread_count, size_type{ 1 }), n) };
+
+	if (workers <= 1)
+	{
+		f(size_type{ 0 }, n);
+		return;
+	}
+
+	std::vector<std::thread> threads;
+	threads.reserve(workers - 1);
+
+	for (size_type w{ 1 }; w != workers; ++w)
+	{
+		threads.emplace_back([&f, w, workers, n]
+		{
+			f(w * n / workers, (w + 1) * n / workers);
+		});
+	}
+
+	f(size_type{ 0 }, n / workers);
+
+	for (auto& t : threads)
+	{
+		t.join();
+	}
+}
+//////////////////////////////////////////////////////////////////////////////////
+// transform_into
+//////////////////////////////////////////////////////////////////////////////////
+template<class S, class B, class F>
+inline void gut::transform_into(gut::polymorphic_vector<S> const& src,
+	gut::polymorphic_vector<B>& dst, F&& f)
+{
+	gut::transform_plan<B>::run(src, dst, std::forward<F>(f));
+}
+
+template<class S, class B, class Shape, class Build>
+inline void gut::transform_into(gut::polymorphic_vector<S> const& src,
+	gut::polymorphic_vector<B>& dst, Shape&& shape, Build&& build, std::size_t const thread_count)
+{
+	gut::transform_plan<B>{}.run(src, dst, std::forward<Shape>(shape),
+		std::forward<Build>(build), thread_count);
+}
+//////////////////////////////////////////////////////////////////////////////////
+// double_buffer
+//////////////////////////////////////////////////////////////////////////////////
+template<class B>
+inline gut::double_buffer<B>::double_buffer(size_type const capacity,
+	gut::placement const p, gut::arena_backing const b)
+	: buffers_{ vector_type{ capacity, p, b }, vector_type{ capacity, p, b } }
+	, current_{ 0 }
+{}
+
+template<class B>
+inline typename gut::double_buffer<B>::vector_type&
+gut::double_buffer<B>::current() noexcept
+{
+	return buffers_[current_];
+}
+
+template<class B>
+inline typename gut::double_buffer<B>::vector_type const&
+gut::double_buffer<B>::current() const noexcept
+{
+	return buffers_[current_];
+}
+
+template<class B>
+inline typename gut::double_buffer<B>::vector_type&
+gut::double_buffer<B>::previous() noexcept
+{
+	return buffers_[current_ ^ 1];
+}
+
+template<class B>
+inline typename gut::double_buffer<B>::vector_type const&
+gut::double_buffer<B>::previous() const noexcept
+{
+	return buffers_[current_ ^ 1];
+}
+
+template<class B>
+template<class F>
+inline void gut::double_buffer<B>::advance(F&& f)
+{
+	gut::transform_plan<B>::run(current(), previous(), std::forward<F>(f));
+	current_ ^= 1;
+}
+
+template<class B>
+template<class Shape, class Build>
+inline void gut::double_buffer<B>::advance(Shape&& shape, Build&& build,
+	size_type const thread_count)
+{
+	plan_.run(current(), previous(), std::forward<Shape>(shape),
+		std::forward<Build>(build), thread_count);
+	current_ ^= 1;
+}
+#endif // GUT_DOUBLE_BUFFER_H
@@ -0,0 +1,739 @@
+#ifndef GUT_FIXED_STRIDE_POLYMORPHIC_VECTOR_H
+#define GUT_FIXED_STRIDE_POLYMORPHIC_VECTOR_H
+
+#include "closed_hierarchy.h"
+#include "polymorphic_vector.h"
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace gut
+{
+	// selects the fixed stride layout of polymorphic_vector for the closed
+	// hierarchy Ds: polymorphic_vector<B, gut::fixed_stride<D1, D2, ...>>
+	template<class... Ds>
+	struct fixed_stride
+	{};
+
+	// iterator over a fixed stride polymorphic_vector: a pointer advanced by a
+	// compile-time stride, with no metadata to load
+	template<class B, bool is_const, std::size_t Stride>
+	class fixed_stride_iterator final
+	{
+	public:
+		using iterator_category = std::random_access_iterator_tag;
+		using value_type = B;
+		using difference_type = std::ptrdiff_t;
+		using pointer = std::conditional_t<is_const, B const*, B*>;
+		using reference = std::conditional_t<is_const, B const&, B&>;
+
+		fixed_stride_iterator() noexcept
+			: p_{ nullptr }
+		{}
+
+		template
+		<
+			bool other_const,
+			std::enable_if_t<is_const && !other_const, int> = 0
+		>
+		fixed_stride_iterator(fixed_stride_iterator<B, other_const, Stride> const& it) noexcept
+			: p_{ it.p_ }
+		{}
+
+		reference operator*() const noexcept
+		{
+			return *reinterpret_cast<pointer>(p_);
+		}
+
+		pointer operator->() const noexcept
+		{
+			return reinterpret_cast<pointer>(p_);
+		}
+
+		reference operator[](difference_type const i) const noexcept
+		{
+			return *reinterpret_cast<pointer>(p_ + i * difference_type(Stride));
+		}
+
+		fixed_stride_iterator& operator++() noexcept
+		{
+			p_ += Stride;
+			return *this;
+		}
+
+		fixed_stride_iterator& operator--() noexcept
+		{
+			p_ -= Stride;
+			return *this;
+		}
+
+		fixed_stride_iterator operator++(int) noexcept
+		{
+			fixed_stride_iterator it{ *this };
+			p_ += Stride;
+			return it;
+		}
+
+		fixed_stride_iterator operator--(int) noexcept
+		{
+			fixed_stride_iterator it{ *this };
+			p_ -= Stride;
+			return it;
+		}
+
+		fixed_stride_iterator& operator+=(difference_type const n) noexcept
+		{
+			p_ += n * difference_type(Stride);
+			return *this;
+		}
+
+		fixed_stride_iterator& operator-=(difference_type const n) noexcept
+		{
+			p_ -= n * difference_type(Stride);
+			return *this;
+		}
+
+		friend fixed_stride_iterator operator+(fixed_stride_iterator lhs, difference_type const n) noexcept
+		{
+			return lhs += n;
+		}
+
+		friend fixed_stride_iterator operator+(difference_type const n, fixed_stride_iterator rhs) noexcept
+		{
+			return rhs += n;
+		}
+
+		friend fixed_stride_iterator operator-(fixed_stride_iterator lhs, difference_type const n) noexcept
+		{
+			return lhs -= n;
+		}
+
+		friend difference_type operator-(fixed_stride_iterator const& lhs,
+			fixed_stride_iterator const& rhs) noexcept
+		{
+			return (lhs.p_ - rhs.p_) / difference_type(Stride);
+		}
+
+		friend bool operator==(fixed_stride_iterator const& lhs, fixed_stride_iterator const& rhs) noexcept
+		{
+			return lhs.p_ == rhs.p_;
+		}
+
+		friend bool operator!=(fixed_stride_iterator const& lhs, fixed_stride_iterator const& rhs) noexcept
+		{
+			return lhs.p_ != rhs.p_;
+		}
+
+		friend bool operator<(fixed_stride_iterator const& lhs, fixed_stride_iterator const& rhs) noexcept
+		{
+			return lhs.p_ < rhs.p_;
+		}
+
+		friend bool operator<=(fixed_stride_iterator const& lhs, fixed_stride_iterator const& rhs) noexcept
+		{
+			return lhs.p_ <= rhs.p_;
+		}
+
+		friend bool operator>(fixed_stride_iterator const& lhs, fixed_stride_iterator const& rhs) noexcept
+		{
+			return lhs.p_ > rhs.p_;
+		}
+
+		friend bool operator>=(fixed_stride_iterator const& lhs, fixed_stride_iterator const& rhs) noexcept
+		{
+			return lhs.p_ >= rhs.p_;
+		}
+
+	private:
+		template<class, class...> friend class polymorphic_vector;
+		template<class, bool, std::size_t> friend class fixed_stride_iterator;
+
+		using byte_pointer = std::conditional_t<is_const, unsigned char const*, unsigned char*>;
+
+		explicit fixed_stride_iterator(byte_pointer p) noexcept
+			: p_{ p }
+		{}
+
+		byte_pointer p_;
+	};
+
+	// polymorphic_vector over a closed hierarchy in which every element
+	// occupies one slot of stride bytes, the largest size of Ds rounded up to
+	// their strictest alignment. element i lives at data_ + i * stride, so
+	// random access and iteration load no metadata at all; a uint8_t type index
+	// per element, kept aside, is only read to copy, relocate or destroy.
+	//
+	// every slot wastes stride - sizeof(D) bytes, which pays off when the sizes
+	// of Ds are close. when all of Ds are trivially relocatable, growth and
+	// erase move the elements with a single memcpy/memmove.
+	template<class B, class... Ds>
+	class polymorphic_vector<B, gut::fixed_stride<Ds...>>
+	{
+	public:
+		using hierarchy = gut::closed_hierarchy<B, Ds...>;
+		using byte = unsigned char;
+		using type_index_t = typename hierarchy::type_index_t;
+		using size_type = std::size_t;
+
+		static constexpr size_type stride{
+			(hierarchy::max_size + hierarchy::max_align - 1) & ~(hierarchy::max_align - 1) };
+
+		using value_type = B;
+		using reference = value_type&;
+		using const_reference = value_type const&;
+		using pointer = value_type*;
+		using const_pointer = value_type const*;
+
+		using iterator = gut::fixed_stride_iterator<B, false, stride>;
+		using const_iterator = gut::fixed_stride_iterator<B, true, stride>;
+		using reverse_iterator = std::reverse_iterator<iterator>;
+		using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+		using difference_type = typename iterator::difference_type;
+
+		// iterators
+		iterator begin() noexcept;
+		const_iterator begin() const noexcept;
+		iterator end() noexcept;
+		const_iterator end() const noexcept;
+
+		reverse_iterator rbegin() noexcept;
+		const_reverse_iterator rbegin() const noexcept;
+		reverse_iterator rend() noexcept;
+		const_reverse_iterator rend() const noexcept;
+
+		const_iterator cbegin() const noexcept;
+		const_iterator cend() const noexcept;
+		const_reverse_iterator crbegin() const noexcept;
+		const_reverse_iterator crend() const noexcept;
+
+		// destructor
+		~polymorphic_vector();
+
+		// constructors; capacity counts elements
+		explicit polymorphic_vector(size_type const capacity = 0);
+
+		polymorphic_vector(polymorphic_vector&& other) noexcept;
+		polymorphic_vector& operator=(polymorphic_vector&& other) noexcept;
+
+		polymorphic_vector(polymorphic_vector const& other);
+		polymorphic_vector& operator=(polymorphic_vector const& other);
+
+		// modifiers
+		template<class T, gut::enable_if_derived_t<B, T> = 0>
+		void push_back(T&& value);
+
+		template<class T, class... Args, gut::enable_if_derived_t<B, T> = 0>
+		void emplace_back(Args&&... args);
+
+		iterator erase(const_iterator position);
+		iterator erase(const_iterator begin, const_iterator end);
+
+		void pop_back();
+		void swap(polymorphic_vector& other) noexcept;
+		void clear();
+
+		// element access
+		reference operator[](size_type const i) noexcept;
+		const_reference operator[](size_type const i) const noexcept;
+
+		reference at(size_type const i);
+		const_reference at(size_type const i) const;
+
+		reference front() noexcept;
+		const_reference front() const noexcept;
+
+		reference back() noexcept;
+		const_reference back() const noexcept;
+
+		// position of the dynamic type of element i in Ds
+		type_index_t type_index(size_type const i) const noexcept;
+
+		template<class T>
+		static constexpr type_index_t index_of() noexcept;
+
+		// capacity
+		size_type size() const noexcept;
+		bool empty() const noexcept;
+		size_type capacity() const noexcept;
+		void reserve(size_type const n);
+
+	private:
+		byte* slot(size_type const i) const noexcept;
+
+		void destroy(size_type i, size_type const j) noexcept;
+
+		// moves the n elements starting at slot src to slot dst
+		void relocate(size_type dst, size_type src, size_type n) noexcept;
+
+		void reallocate(size_type const ncap);
+
+		void ensure_index_bounds(size_type const i) const;
+
+		static byte* allocate(size_type const count, void*& raw);
+
+		// data_ is aligned to max_align inside the block raw_ returned by malloc
+		void* raw_;
+		byte* data_;
+		size_type cap_;
+		std::vector<type_index_t> types_;
+	};
+}
+//////////////////////////////////////////////////////////////////////////////////
+// static data
+//////////////////////////////////////////////////////////////////////////////////
+template<class B, class... Ds>
+constexpr typename gut::polymorphic_vector<B, gut::fixed_stride<Ds...>>::size_type
+gut::polymorphic_vector<B, gut::fixed_stride<Ds...>>::stride;
+//////////////////////////////////////////////////////////////////////////////////
+// iterators
+//////////////////////////////////////////////////////////////////////////////////
+template<class B, class... Ds>
+inline typename gut::polymorphic_vector<B, gut::fixed_stride<Ds...>>::iterator
+gut::polymorphic_vector<B, gut::fixed_stride<Ds...>>::begin() noexcept
+{
+	return iterator{ data_ };
+}
+
+template<class B, class... Ds>
+inline typename gut::polymorphic_vector<B, gut::fixed_stride<Ds...>>::const_iterator
+gut::polymorphic_vector<B, gut::fixed_stride<Ds...>>::begin() const noexcept
+{
+	return const_iterator{ data_ };
+}
+
+template<class B, class... Ds>
+inline typename gut::polymorphic_vector<B, gut::fixed_stride<Ds...>>::iterator
+gut::polymorphic_vector<B, gut::fixed_stride<Ds...>>::end() noexcept
+{
+	return iterator{ slot(types_.size()) };
+}
+
+template<class B, class... Ds>
+inline typename gut::polymorphic_vector<B, gut::fixed_stride<Ds...>>::const_iterator
+gut::polymorphic_vector<B, gut::fixed_stride<Ds...>>::end() const noexcept
+{
+	return const_iterator{ slot(types_.size()) };
+}
+
+template<class B, class... Ds>
+inline typename gut::polymorphic_vector<B, gut::fixed_stride<Ds...>>::reverse_iterator
+gut::polymorphic_vector<B, gut::fixed_stride<Ds...>>::rbegin() noexcept
+{
+	return reverse_iterator{ end() };
+}
+
+template<class B, class... Ds>
+inline typename gut::polymorphic_vector<B, gut::fixed_stride<Ds...>>::const_reverse_iterator
+gut::polymorphic_vector<B, gut::fixed_stride<Ds...>>::rbegin() const noexcept
+{
+	return const_reverse_iterator{ end() };
+}
+
+template<class B, class... Ds>
+inline typename gut::polymorphic_vector<B, gut::fixed_stride<Ds...>>::reverse_iterator
+gut::polymorphic_vector<B, gut::fixed_stride<Ds...>>::rend() noexcept
+{
+	return reverse_iterator{ begin() };
+}
+
+template<class B, class... Ds>
+inline typename gut::polymorphic_vector<B, gut::fixed_stride<Ds...>>::const_reverse_iterator
+gut::polymorphic_vector<B, gut::fixed_stride<Ds...>>::rend() const noexcept
+{
+	return const_reverse_iterator{ begin() };
+}
+
+template<class B, class... Ds>
+inline typename gut::polymorphic_vector<B, gut::fixed_stride<Ds...>>::const_iterator
+gut::polymorphic_vector<B, gut::fixed_stride<Ds...>>::cbegin() const noexcept
+{
+	return begin();
+}
+
+template<class B, class... Ds>
+inline typename gut::polymorphic_vector<B, gut::fixed_stride<Ds...>>::const_iterator
+gut::polymorphic_vector<B, gut::fixed_stride<Ds...>>::cend() const noexcept
+{
+	return end();
+}
+
+template<class B, class... Ds>
+inline typename gut::polymorphic_vector<B, gut::fixed_stride<Ds...>>::const_reverse_iterator
+gut::polymorphic_vector<B, gut::fixed_stride<Ds...>>::crbegin() const noexcept
+{
+	return rbegin();
+}
+
+template<class B, class... Ds>
+inline typename gut::polymorphic_vector<B, gut::fixed_stride<Ds...>>::const_reverse_iterator
+gut::polymorphic_vector<B, gut::fixed_stride<Ds...>>::crend() const noexcept
+{
+	return rend();
+}
+//////////////////////////////////////////////////////////////////////////////////
+// destructor
+//////////////////////////////////////////////////////////////////////////////////
+template<class B, class... Ds>
+inline gut::polymorphic_vector<B, gut::fixed_stride<Ds...>>::~polymorphic_vector()
+{
+	destroy(0, types_.size());
+	std::free(raw_);
+}
+//////////////////////////////////////////////////////////////////////////////////
+// constructors/assignment
+//////////////////////////////////////////////////////////////////////////////////
+template<class B, class... Ds>
+inline gut::polymorphic_vector<B, gut::fixed_stride<Ds...>>::polymorphic_vector(size_type const capacity)
+	: raw_{ nullptr }
+	, data_{ allocate(capacity, raw_) }
+	, cap_{ capacity }
+{}
+
+template<class B, class... Ds>
+inline gut::polymorphic_vector<B, gut::fixed_stride<Ds...>>::polymorphic_vector(
+	polymorphic_vector&& other) noexcept
+	: raw_{ other.raw_ }
+	, data_{ other.data_ }
+	, cap_{ other.cap_ }
+	, types_{ std::move(other.types_) }
+{
+	other.raw_ = nullptr;
+	other.data_ = nullptr;
+	other.cap_ = 0;
+	other.types_.clear();
+}
+
+template<class B, class... Ds>
+inline gut::polymorphic_vector<B, gut::fixed_stride<Ds...>>&
+gut::polymorphic_vector<B, gut::fixed_stride<Ds...>>::operator=(polymorphic_vector&& other) noexcept
+{
+	if (this != &other)
+	{
+		polymorphic_vector tmp{ std::move(other) };
+		swap(tmp);
+	}
+	return *this;
+}
+
+template<class B, class... Ds>
+gut::polymorphic_vector<B, gut::fixed_stride<Ds...>>::polymorphic_vector(polymorphic_vector const& other)
+	: polymorphic_vector(other.types_.size())
+{
+	types_.reserve(other.types_.size());
+	for (size_type i{ 0 }, sz{ other.types_.size() }; i != sz; ++i)
+	{
+		type_index_t const t{ other.types_[i] };
+		hierarchy::copy[t](slot(i), other.slot(i));
+		types_.push_back(t);
+	}
+}
+
+template<class B, class... Ds>
+inline gut::polymorphic_vector<B, gut::fixed_stride<Ds...>>&
+gut::polymorphic_vector<B, gut::fixed_stride<Ds...>>::operator=(polymorphic_vector const& other)
+{
+	if (this != &other)
+	{
+		polymorphic_vector tmp{ other };
+		swap(tmp);
+	}
+	return *this;
+}
+//////////////////////////////////////////////////////////////////////////////////
+// modifiers
+//////////////////////////////////////////////////////////////////////////////////
+template<class B, class... Ds>
+template<class T, gut::enable_if_derived_t<B, T>>
+inline void gut::polymorphic_vector<B, gut::fixed_stride<Ds...>>::push_back(T&& value)
+{
+	emplace_back<std::decay_t<T>>(std::forward<T>(value));
+}
+
+template<class B, class... Ds>
+template<class T, class... Args, gut::enable_if_derived_t<B, T>>
+inline void gut::polymorphic_vector<B, gut::fixed_stride<Ds...>>::emplace_back(Args&&... args)
+{
+	static_assert(hierarchy::template contains<T>(),
+		"T is not a member of the closed hierarchy of this polymorphic_vector");
+
+	size_type const i{ types_.size() };
+	if (i == cap_)
+	{
+		reallocate(std::max(cap_ * 2, size_type{ 8 }));
+	}
+
+	types_.push_back(hierarchy::template index_of<T>());
+	try
+	{
+		::new (slot(i)) T{ std::forward<Args>(args)... };
+	}
+	catch (...)
+	{
+		types_.pop_back();
+		throw;
+	}
+}
+
+template<class B, class... Ds>
+inline typename gut::polymorphic_vector<B, gut::fixed_stride<Ds...>>::iterator
+gut::polymorphic_vector<B, gut::fixed_stride<Ds...>>::erase(const_iterator position)
+{
+	return erase(position, position + 1);
+}
+
+template<class B, class... Ds>
+typename gut::polymorphic_vector<B, gut::fixed_stride<Ds...>>::iterator
+gut::polymorphic_vector<B, gut::fixed_stride<Ds...>>::erase(const_iterator begin, const_iterator end)
+{
+	size_type const i = (begin.p_ - data_) / stride;
+	size_type const j = (end.p_ - data_) / stride;
+	size_type const n{ types_.size() };
+
+	assert(i <= j);
+	assert(j <= n);
+
+	if (i != j)
+	{
+		destroy(i, j);
+		relocate(i, j, n - j);
+		types_.erase(types_.begin() + i, types_.begin() + j);
+	}
+	return iterator{ slot(i) };
+}
+
+template<class B, class... Ds>
+inline void gut::polymorphic_vector<B, gut::fixed_stride<Ds...>>::pop_back()
+{
+	assert(!types_.empty());
+
+	destroy(types_.size() - 1, types_.size());
+	types_.pop_back();
+}
+
+template<class B, class... Ds>
+inline void gut::polymorphic_vector<B, gut::fixed_stride<Ds...>>::swap(polymorphic_vector& other) noexcept
+{
+	std::swap(raw_, other.raw_);
+	std::swap(data_, other.data_);
+	std::swap(cap_, other.cap_);
+	types_.swap(other.types_);
+}
+
+template<class B, class... Ds>
+inline void gut::polymorphic_vector<B, gut::fixed_stride<Ds...>>::clear()
+{
+	destroy(0, types_.size());
+	types_.clear();
+}
+//////////////////////////////////////////////////////////////////////////////////
+// element access
+//////////////////////////////////////////////////////////////////////////////////
+template<class B, class... Ds>
+inline typename gut::polymorphic_vector<B, gut::fixed_stride<Ds...>>::reference
+gut::polymorphic_vector<B, gut::fixed_stride<Ds...>>::operator[](size_type const i) noexcept
+{
+	return *reinterpret_cast<pointer>(slot(i));
+}
+
+template<class B, class... Ds>
+inline typename gut::polymorphic_vector<B, gut::fixed_stride<Ds...>>::const_reference
+gut::polymorphic_vector<B, gut::fixed_stride<Ds...>>::operator[](size_type const i) const noexcept
+{
+	return *reinterpret_cast<const_pointer>(slot(i));
+}
+
+template<class B, class... Ds>
+inline typename gut::polymorphic_vector<B, gut::fixed_stride<Ds...>>::reference
+gut::polymorphic_vector<B, gut::fixed_stride<Ds...>>::at(size_type const i)
+{
+	ensure_index_bounds(i);
+	return (*this)[i];
+}
+
+template<class B, class... Ds>
+inline typename gut::polymorphic_vector<B, gut::fixed_stride<Ds...>>::const_reference
+gut::polymorphic_vector<B, gut::fixed_stride<Ds...>>::at(size_type const i) const
+{
+	ensure_index_bounds(i);
+	return (*this)[i];
+}
+
+template<class B, class... Ds>
+inline typename gut::polymorphic_vector<B, gut::fixed_stride<Ds...>>::reference
+gut::polymorphic_vector<B, gut::fixed_stride<Ds...>>::front() noexcept
+{
+	return (*this)[0];
+}
+
+template<class B, class... Ds>
+inline typename gut::polymorphic_vector<B, gut::fixed_stride<Ds...>>::const_reference
+gut::polymorphic_vector<B, gut::fixed_stride<Ds...>>::front() const noexcept
+{
+	return (*this)[0];
+}
+
+template<class B, class... Ds>
+inline typename gut::polymorphic_vector<B, gut::fixed_stride<Ds...>>::reference
+gut::polymorphic_vector<B, gut::fixed_stride<Ds...>>::back() noexcept
+{
+	return (*this)[types_.size() - 1];
+}
+
+template<class B, class... Ds>
+inline typename gut::polymorphic_vector<B, gut::fixed_stride<Ds...>>::const_reference
+gut::polymorphic_vector<B, gut::fixed_stride<Ds...>>::back() const noexcept
+{
+	return (*this)[types_.size() - 1];
+}
+
+template<class B, class... Ds>
+inline typename gut::polymorphic_vector<B, gut::fixed_stride<Ds...>>::type_index_t
+gut::polymorphic_vector<B, gut::fixed_stride<Ds...>>::type_index(size_type const i) const noexcept
+{
+	return types_[i];
+}
+
+template<class B, class... Ds>
+template<class T>
+inline constexpr typename gut::polymorphic_vector<B, gut::fixed_stride<Ds...>>::type_index_t
+gut::polymorphic_vector<B, gut::fixed_stride<Ds...>>::index_of() noexcept
+{
+	return hierarchy::template index_of<T>();
+}
+//////////////////////////////////////////////////////////////////////////////////
+// capacity
+//////////////////////////////////////////////////////////////////////////////////
+template<class B, class... Ds>
+inline typename gut::polymorphic_vector<B, gut::fixed_stride<Ds...>>::size_type
+gut::polymorphic_vector<B, gut::fixed_stride<Ds...>>::size() const noexcept
+{
+	return types_.size();
+}
+
+template<class B, class... Ds>
+inline bool gut::polymorphic_vector<B, gut::fixed_stride<Ds...>>::empty() const noexcept
+{
+	return types_.empty();
+}
+
+template<class B, class... Ds>
+inline typename gut::polymorphic_vector<B, gut::fixed_stride<Ds...>>::size_type
+gut::polymorphic_vector<B, gut::fixed_stride<Ds...>>::capacity() const noexcept
+{
+	return cap_;
+}
+
+template<class B, class... Ds>
+inline void gut::polymorphic_vector<B, gut::fixed_stride<Ds...>>::reserve(size_type const n)
+{
+	if (n > cap_)
+	{
+		reallocate(n);
+	}
+}
+///////////////////////////////////////////////////////////////////////////////
+// private member functions
+///////////////////////////////////////////////////////////////////////////////
+template<class B, class... Ds>
+inline typename gut::polymorphic_vector<B, gut::fixed_stride<Ds...>>::byte*
+gut::polymorphic_vector<B, gut::fixed_stride<Ds...>>::slot(size_type const i) const noexcept
+{
+	return data_ + i * stride;
+}
+
+template<class B, class... Ds>
+inline void gut::polymorphic_vector<B, gut::fixed_stride<Ds...>>::destroy(
+	size_type i, size_type const j) noexcept
+{
+	for (; i != j; ++i)
+	{
+		hierarchy::destroy[types_[i]](slot(i));
+	}
+}
+
+template<class B, class... Ds>
+inline void gut::polymorphic_vector<B, gut::fixed_stride<Ds...>>::relocate(
+	size_type dst, size_type src, size_type n) noexcept
+{
+	if (hierarchy::trivially_relocatable)
+	{
+		std::memmove(slot(dst), slot(src), n * stride);
+		return;
+	}
+
+	// a slot holds a whole object, so moving to a lower slot never overlaps
+	for (; n != 0; --n, ++dst, ++src)
+	{
+		hierarchy::relocate[types_[src]](slot(dst), slot(src));
+	}
+}
+
+template<class B, class... Ds>
+void gut::polymorphic_vector<B, gut::fixed_stride<Ds...>>::reallocate(size_type const ncap)
+{
+	void* nraw{ nullptr };
+	byte* ndata{ allocate(ncap, nraw) };
+	size_type const n{ types_.size() };
+
+	if (hierarchy::trivially_relocatable)
+	{
+		std::memcpy(ndata, data_, n * stride);
+	}
+	else
+	{
+		for (size_type i{ 0 }; i != n; ++i)
+		{
+			hierarchy::relocate[types_[i]](ndata + i * stride, slot(i));
+		}
+	}
+
+	std::free(raw_);
+	raw_ = nraw;
+	data_ = ndata;
+	cap_ = ncap;
+}
+
+template<class B, class... Ds>
+inline void gut::polymorphic_vector<B, gut::fixed_stride<Ds...>>::ensure_index_bounds(size_type const i) const
+{
+	if (i >= types_.size())
+	{
+		throw std::out_of_range
+		{
+			"polymorphic_vector<B, fixed_stride<Ds...>>::ensure_index_bounds( size_type const i );\n"
+			"index out of range"
+		};
+	}
+}
+
+template<class B, class... Ds>
+typename gut::polymorphic_vector<B, gut::fixed_stride<Ds...>>::byte*
+gut::polymorphic_vector<B, gut::fixed_stride<Ds...>>::allocate(size_type const count, void*& raw)
+{
+	if (count > (size_type(-1) - hierarchy::max_align) / stride)
+	{
+		throw std::length_error
+		{
+			"polymorphic_vector<B, fixed_stride<Ds...>>::allocate( size_type const count, void*& raw );\n"
+			"capacity too large"
+		};
+	}
+
+	raw = std::malloc(count * stride + hierarchy::max_align - 1);
+	if (!raw)
+	{
+		throw std::bad_alloc{};
+	}
+	return make_aligned(raw, hierarchy::max_align);
+}
+#endif // GUT_FIXED_STRIDE_POLYMORPHIC_VECTOR_H
@@ -3,8 +3,14 @@
 
 #include "handle_base.h"
 #include "polymorphic_handle.h"
+#include "relocation_traits.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <typeinfo>
 #include <utility>
 #include <type_traits>
+#include <vector>
 
 namespace gut
 {
@@ -31,20 +37,34 @@ namespace gut
 
 		virtual size_type align() const noexcept;
 		virtual size_type size() const noexcept;
+		virtual std::type_info const& type() const noexcept;
+		virtual bool is_trivially_relocatable() const noexcept;
 
-		virtual void destroy()
-		noexcept(std::is_nothrow_destructible<T>::value)
+		// as in handle_base; a conditional noexcept on an override of a
+		// potentially throwing virtual is rejected by some compilers
+		virtual void destroy() override;
+		virtual void transfer(void* nblk, void* nsrc) override;
+		virtual void copy(void* blk, void* dst, gut::polymorphic_handle& out_handle) const override;
+
+		virtual gut::polymorphic_handle const* run_end(gut::polymorphic_handle const* first,
+			gut::polymorphic_handle const* last) const
 		override;
 
-		virtual void transfer(void* nblk, void* nsrc)
-		noexcept(noexcept(std::declval<handle>().transfer(is_moveable, nsrc)))
+		virtual gut::polymorphic_handle* destroy_run(gut::polymorphic_handle* first,
+			gut::polymorphic_handle* last)
 		override;
 
-		virtual void copy(void* blk, void* dst, gut::polymorphic_handle& out_handle) const
-		noexcept(std::is_nothrow_copy_constructible<T>::value)
+		virtual void copy_run(gut::polymorphic_handle const* first, size_type const n,
+			void* blk, void* dst, std::vector<gut::polymorphic_handle>& out) const
 		override;
 
 	private:
+		void copy_run(std::true_type, gut::polymorphic_handle const* first, size_type const n,
+			void* blk, unsigned char* dst, std::vector<gut::polymorphic_handle>& out) const;
+
+		void copy_run(std::false_type, gut::polymorphic_handle const* first, size_type const n,
+			void* blk, unsigned char* dst, std::vector<gut::polymorphic_handle>& out) const;
+
 		void transfer(std::true_type, void* nsrc)
 		noexcept(std::is_nothrow_move_constructible<T>::value);
 
@@ -74,9 +94,20 @@ inline typename gut::handle<T>::size_type gut::handle<T>::size() const noexcept
 	return sizeof(T);
 }
 
+template<class T>
+inline std::type_info const& gut::handle<T>::type() const noexcept
+{
+	return typeid(T);
+}
+
+template<class T>
+inline bool gut::handle<T>::is_trivially_relocatable() const noexcept
+{
+	return gut::is_trivially_relocatable<T>::value;
+}
+
 template<class T>
 inline void gut::handle<T>::destroy()
-noexcept(std::is_nothrow_destructible<T>::value)
 {
 	reinterpret_cast<T*>(src_)->~T();
 	src_ = nullptr;
@@ -84,19 +115,57 @@ noexcept(std::is_nothrow_destructible<T>::value)
 
 template<class T>
 inline void gut::handle<T>::transfer(void* nblk, void* nsrc)
-noexcept(noexcept(std::declval<handle>().transfer(is_moveable, nsrc)))
 {
 	blk_ = nblk;
 	transfer(is_moveable, nsrc);
 }
 
 template<class T>
-inline void gut::handle<T>::copy(void* blk, void* dst, gut::polymorphic_handle& out_handle)
-const noexcept(std::is_nothrow_copy_constructible<T>::value)
+inline void gut::handle<T>::copy(void* blk, void* dst, gut::polymorphic_handle& out_handle) const
 {
 	T* p{ ::new (dst) T{ *reinterpret_cast<T*>(src_) } };
 	out_handle = gut::polymorphic_handle{ gut::handle<T>{ blk, p } };
 }
+
+template<class T>
+inline gut::polymorphic_handle const* gut::handle<T>::run_end(gut::polymorphic_handle const* first,
+	gut::polymorphic_handle const* last) const
+{
+	// first holds this handle; the run goes on while the type index does
+	std::uint32_t const type{ first->type_index() };
+	while (++first != last && first->type_index() == type)
+	{
+	}
+	return first;
+}
+
+template<class T>
+inline gut::polymorphic_handle* gut::handle<T>::destroy_run(gut::polymorphic_handle* first,
+	gut::polymorphic_handle* last)
+{
+	auto const end = const_cast<gut::polymorphic_handle*>(run_end(first, last));
+
+	if (!std::is_trivially_destructible<T>::value)
+	{
+		for (; first != end; ++first)
+		{
+			reinterpret_cast<T*>((*first)->src())->~T();
+		}
+	}
+	return end;
+}
+
+template<class T>
+inline void gut::handle<T>::copy_run(gut::polymorphic_handle const* first, size_type const n,
+	void* blk, void* dst, std::vector<gut::polymorphic_handle>& out) const
+{
+	// no reallocation between constructing an element and owning its handle
+	if (out.capacity() - out.size() < n)
+	{
+		out.reserve(std::max(out.capacity() * 2, out.size() + n));
+	}
+	copy_run(std::is_trivially_copyable<T>{}, first, n, blk, static_cast<unsigned char*>(dst), out);
+}
 //////////////////////////////////////////////////////////////////////////////////
 // private functions
 //////////////////////////////////////////////////////////////////////////////////
@@ -117,4 +186,48 @@ noexcept(std::is_nothrow_copy_constructible<T>::value)
 	src_ = ::new (nsrc) T{ *old_src };
 	old_src->~T();
 }
+
+template<class T>
+inline void gut::handle<T>::copy_run(std::true_type, gut::polymorphic_handle const* first,
+	size_type const n, void* blk, unsigned char* dst, std::vector<gut::polymorphic_handle>& out) const
+{
+	auto const src = static_cast<unsigned char const*>(first[0]->src());
+
+	// a run lying back to back in the source goes in a single memcpy
+	size_type k{ 1 };
+	while (k != n && first[k]->src() == src + k * sizeof(T))
+	{
+		++k;
+	}
+
+	if (k == n)
+	{
+		std::memcpy(dst, src, n * sizeof(T));
+	}
+	else
+	{
+		for (k = 0; k != n; ++k)
+		{
+			std::memcpy(dst + k * sizeof(T), first[k]->src(), sizeof(T));
+		}
+	}
+
+	out.emplace_back(gut::handle<T>{ blk, dst });
+	for (k = 1; k != n; ++k)
+	{
+		out.emplace_back(gut::handle<T>{ dst + k * sizeof(T), dst + k * sizeof(T) });
+	}
+}
+
+template<class T>
+inline void gut::handle<T>::copy_run(std::false_type, gut::polymorphic_handle const* first,
+	size_type const n, void* blk, unsigned char* dst, std::vector<gut::polymorphic_handle>& out) const
+{
+	for (size_type k{ 0 }; k != n; ++k)
+	{
+		void* const d{ dst + k * sizeof(T) };
+		T* p{ ::new (d) T{ *reinterpret_cast<T const*>(first[k]->src()) } };
+		out.emplace_back(gut::handle<T>{ k == 0 ? blk : d, p });
+	}
+}
 #endif // GUT_HANDLE_H
\ No newline at end of file
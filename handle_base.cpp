@@ -0,0 +1,38 @@
+#include "handle_base.h"
+#include <mutex>
+#include <typeindex>
+#include <unordered_map>
+
+namespace
+{
+	// std::type_index compares and hashes type_info values, not addresses
+	struct type_table
+	{
+		std::mutex mutex;
+		std::unordered_map<std::type_index, std::uint32_t> indices;
+	};
+
+	type_table& table()
+	{
+		static type_table t;
+		return t;
+	}
+}
+
+std::uint32_t gut::type_index(std::type_info const& type)
+{
+	auto& t = table();
+	std::lock_guard<std::mutex> lock{ t.mutex };
+
+	auto const next = static_cast<std::uint32_t>(t.indices.size());
+	return t.indices.emplace(std::type_index{ type }, next).first->second;
+}
+
+std::uint32_t gut::find_type_index(std::type_info const& type) noexcept
+{
+	auto& t = table();
+	std::lock_guard<std::mutex> lock{ t.mutex };
+
+	auto const it = t.indices.find(std::type_index{ type });
+	return it != t.indices.end() ? it->second : gut::no_type_index;
+}
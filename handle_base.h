@@ -1,12 +1,52 @@
 #ifndef GUT_HANDLE_BASE_H
 #define GUT_HANDLE_BASE_H
 
+#include <atomic>
 #include <cstddef>
+#include <cstdint>
+#include <typeinfo>
+#include <vector>
 
 namespace gut
 {
 	template<class T> class handle;
 
+	// a small index for every type held by a handle, the same in all modules
+	// of a process even where their type_info objects are distinct. type_info
+	// values are only compared when a type is looked up by its type_info,
+	// once per type and module; handles compare the indices
+	constexpr std::uint32_t no_type_index{ ~std::uint32_t{ 0 } };
+
+	// registers type if it is new
+	std::uint32_t type_index(std::type_info const& type);
+
+	// no_type_index for a type that was never registered
+	std::uint32_t find_type_index(std::type_info const& type) noexcept;
+
+	// the index of T, registered on the first call
+	template<class T>
+	std::uint32_t type_index_of()
+	{
+		static std::uint32_t const index{ gut::type_index(typeid(T)) };
+		return index;
+	}
+
+	// the index of T without registering it; no_type_index means that no
+	// handle holds a T yet
+	template<class T>
+	std::uint32_t find_type_index_of() noexcept
+	{
+		static std::atomic<std::uint32_t> index{ gut::no_type_index };
+
+		std::uint32_t i{ index.load(std::memory_order_relaxed) };
+		if (i == gut::no_type_index)
+		{
+			i = gut::find_type_index(typeid(T));
+			index.store(i, std::memory_order_relaxed);
+		}
+		return i;
+	}
+
 	class polymorphic_handle;
 
 	class handle_base
@@ -25,14 +65,32 @@ namespace gut
 
 		virtual size_type align() const noexcept = 0;
 		virtual size_type size() const noexcept = 0;
+		virtual std::type_info const& type() const noexcept = 0;
+		virtual bool is_trivially_relocatable() const noexcept = 0;
 
 		virtual void destroy() = 0;
 		virtual void transfer(void* nblk, void* nsrc) = 0;
 		virtual void copy(void* blk, void* dst, polymorphic_handle& out_handle) const = 0;
 
+		// runs of elements of one type. each takes handles starting at this one
+		// and works through the run with a single loop over the concrete type:
+		// run_end() finds where the run stops within [first, last),
+		// destroy_run() destroys it, skipping trivially destructible types, and
+		// returns its end, and copy_run() copies the n elements of a run back to
+		// back from dst on, the first one owning blk, appending their handles
+		virtual polymorphic_handle const* run_end(polymorphic_handle const* first,
+			polymorphic_handle const* last) const = 0;
+		virtual polymorphic_handle* destroy_run(polymorphic_handle* first,
+			polymorphic_handle* last) = 0;
+		virtual void copy_run(polymorphic_handle const* first, size_type const n,
+			void* blk, void* dst, std::vector<polymorphic_handle>& out) const = 0;
+
 		void* blk() const noexcept;
 		void* src() const noexcept;
 
+		// points the handle at an object whose bytes were already relocated
+		void rebind(void* blk, void* src) noexcept;
+
 	protected:
 		handle_base(void* blk, void* src) noexcept;
 
@@ -77,4 +135,12 @@ inline void* gut::handle_base::src() const noexcept
 {
 	return src_;
 }
+//////////////////////////////////////////////////////////////////////////////////
+// modifiers
+//////////////////////////////////////////////////////////////////////////////////
+inline void gut::handle_base::rebind(void* blk, void* src) noexcept
+{
+	blk_ = blk;
+	src_ = src;
+}
 #endif // GUT_HANDLE_BASE_H
\ No newline at end of file
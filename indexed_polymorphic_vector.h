@@ -0,0 +1,562 @@
+#ifndef GUT_INDEXED_POLYMORPHIC_VECTOR_H
+#define GUT_INDEXED_POLYMORPHIC_VECTOR_H
+
+#include "polymorphic_vector.h"
+#include "projected_polymorphic_vector.h"
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <functional>
+#include <numeric>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace gut
+{
+	// polymorphic_vector<B> with a hash index over a unique key projected from
+	// every element, such as an id member of B. the projection is a pointer to
+	// a data member of B, a const getter of B or any callable taking B const&.
+	//
+	// the index is a flat open addressing table with linear probing. its slots
+	// hold element positions rather than addresses, so compaction, which moves
+	// objects but not positions, leaves it untouched; emplace, erase, sort and
+	// pop_back keep it up to date. keys are copied into a dense array next to
+	// the table, so an element whose key changed through a reference must be
+	// passed to rekey() before it can be found by the new key.
+	template
+	<
+		class B,
+		class Projection,
+		class Hash = std::hash<std::decay_t<decltype(detail::project(
+			std::declval<Projection const&>(), std::declval<B const&>()))>>,
+		class KeyEqual = std::equal_to<>
+	>
+	class indexed_polymorphic_vector
+	{
+	public:
+		using vector_type = gut::polymorphic_vector<B>;
+		using size_type = typename vector_type::size_type;
+		using key_type = std::decay_t<decltype(detail::project(
+			std::declval<Projection const&>(), std::declval<B const&>()))>;
+
+		using reference = typename vector_type::reference;
+		using const_reference = typename vector_type::const_reference;
+		using pointer = typename vector_type::pointer;
+		using const_pointer = typename vector_type::const_pointer;
+		using iterator = typename vector_type::iterator;
+		using const_iterator = typename vector_type::const_iterator;
+
+		static constexpr size_type npos{ static_cast<size_type>(-1) };
+
+		explicit indexed_polymorphic_vector(Projection projection,
+			size_type const capacity = 0, Hash hash = Hash{}, KeyEqual equal = KeyEqual{});
+
+		// iterators
+		iterator begin() noexcept;
+		const_iterator begin() const noexcept;
+		iterator end() noexcept;
+		const_iterator end() const noexcept;
+
+		// modifiers; inserting an element whose key is already present throws
+		// std::invalid_argument and leaves the vector as it was
+		template<class D, gut::enable_if_derived_t<B, D> = 0>
+		void push_back(D&& value);
+
+		template<class D, class... Args, gut::enable_if_derived_t<B, D> = 0>
+		void emplace_back(Args&&... args);
+
+		void erase(size_type const i);
+		void erase(size_type const first, size_type const last);
+
+		void pop_back();
+		void clear();
+
+		template<class Compare = std::less<>>
+		void sort(Compare comp = Compare{});
+
+		void compact_in_order();
+		size_type compact(gut::packing const p = gut::packing::in_order);
+		size_type compact_step(size_type const byte_budget);
+
+		// takes the current key of element i into the index
+		void rekey(size_type const i);
+
+		// lookup
+		pointer find(key_type const& key) noexcept;
+		const_pointer find(key_type const& key) const noexcept;
+
+		// position of the element with the given key, or npos
+		size_type position(key_type const& key) const noexcept;
+		bool contains(key_type const& key) const noexcept;
+
+		// element access
+		reference operator[](size_type const i) noexcept;
+		const_reference operator[](size_type const i) const noexcept;
+
+		reference at(size_type const i);
+		const_reference at(size_type const i) const;
+
+		vector_type const& elements() const noexcept;
+		key_type const& key(size_type const i) const noexcept;
+
+		// capacity
+		size_type size() const noexcept;
+		bool empty() const noexcept;
+
+	private:
+		key_type project(B const& value) const;
+
+		// the slot the probe for a key starts at
+		size_type home(key_type const& key) const noexcept;
+
+		// the slot holding position i, which must be indexed
+		size_type slot_of(size_type const i) const noexcept;
+
+		// the slot holding key, or the empty slot where it would go
+		size_type probe(key_type const& key) const noexcept;
+
+		// empties slot s and shifts the rest of its probe run back, so that no
+		// tombstones are needed
+		void erase_slot(size_type s) noexcept;
+
+		// indexes position i under keys_[i]; throws if the key is taken
+		void insert(size_type const i);
+
+		// grows the table so that n keys fit under the maximum load factor
+		void reserve_slots(size_type const n);
+		void rebuild();
+
+		vector_type elements_;
+		std::vector<key_type> keys_;
+		std::vector<size_type> slots_;
+		Projection projection_;
+		Hash hash_;
+		KeyEqual equal_;
+	};
+
+	template<class B, class Projection>
+	indexed_polymorphic_vector<B, Projection> make_indexed(Projection projection,
+		std::size_t const capacity = 0)
+	{
+		return indexed_polymorphic_vector<B, Projection>{ projection, capacity };
+	}
+}
+//////////////////////////////////////////////////////////////////////////////////
+// static data
+//////////////////////////////////////////////////////////////////////////////////
+template<class B, class Projection, class Hash, class KeyEqual>
+constexpr typename gut::indexed_polymorphic_vector<B, Projection, Hash, KeyEqual>::size_type
+gut::indexed_polymorphic_vector<B, Projection, Hash, KeyEqual>::npos;
+//////////////////////////////////////////////////////////////////////////////////
+// constructors
+//////////////////////////////////////////////////////////////////////////////////
+template<class B, class Projection, class Hash, class KeyEqual>
+inline gut::indexed_polymorphic_vector<B, Projection, Hash, KeyEqual>::indexed_polymorphic_vector(
+	Projection projection, size_type const capacity, Hash hash, KeyEqual equal)
+	: elements_{ capacity }
+	, projection_(projection)
+	, hash_(hash)
+	, equal_(equal)
+{}
+//////////////////////////////////////////////////////////////////////////////////
+// iterators
+//////////////////////////////////////////////////////////////////////////////////
+template<class B, class Projection, class Hash, class KeyEqual>
+inline typename gut::indexed_polymorphic_vector<B, Projection, Hash, KeyEqual>::iterator
+gut::indexed_polymorphic_vector<B, Projection, Hash, KeyEqual>::begin() noexcept
+{
+	return elements_.begin();
+}
+
+template<class B, class Projection, class Hash, class KeyEqual>
+inline typename gut::indexed_polymorphic_vector<B, Projection, Hash, KeyEqual>::const_iterator
+gut::indexed_polymorphic_vector<B, Projection, Hash, KeyEqual>::begin() const noexcept
+{
+	return elements_.begin();
+}
+
+template<class B, class Projection, class Hash, class KeyEqual>
+inline typename gut::indexed_polymorphic_vector<B, Projection, Hash, KeyEqual>::iterator
+gut::indexed_polymorphic_vector<B, Projection, Hash, KeyEqual>::end() noexcept
+{
+	return elements_.end();
+}
+
+template<class B, class Projection, class Hash, class KeyEqual>
+inline typename gut::indexed_polymorphic_vector<B, Projection, Hash, KeyEqual>::const_iterator
+gut::indexed_polymorphic_vector<B, Projection, Hash, KeyEqual>::end() const noexcept
+{
+	return elements_.end();
+}
+//////////////////////////////////////////////////////////////////////////////////
+// modifiers
+//////////////////////////////////////////////////////////////////////////////////
+template<class B, class Projection, class Hash, class KeyEqual>
+template<class D, gut::enable_if_derived_t<B, D>>
+inline void gut::indexed_polymorphic_vector<B, Projection, Hash, KeyEqual>::push_back(D&& value)
+{
+	emplace_back<std::decay_t<D>>(std::forward<D>(value));
+}
+
+template<class B, class Projection, class Hash, class KeyEqual>
+template<class D, class... Args, gut::enable_if_derived_t<B, D>>
+void gut::indexed_polymorphic_vector<B, Projection, Hash, KeyEqual>::emplace_back(Args&&... args)
+{
+	reserve_slots(keys_.size() + 1);
+
+	elements_.template emplace_back<D>(std::forward<Args>(args)...);
+	try
+	{
+		keys_.push_back(project(elements_.back()));
+	}
+	catch (...)
+	{
+		elements_.pop_back();
+		throw;
+	}
+
+	try
+	{
+		insert(keys_.size() - 1);
+	}
+	catch (...)
+	{
+		keys_.pop_back();
+		elements_.pop_back();
+		throw;
+	}
+}
+
+template<class B, class Projection, class Hash, class KeyEqual>
+inline void gut::indexed_polymorphic_vector<B, Projection, Hash, KeyEqual>::erase(size_type const i)
+{
+	erase(i, i + 1);
+}
+
+template<class B, class Projection, class Hash, class KeyEqual>
+void gut::indexed_polymorphic_vector<B, Projection, Hash, KeyEqual>::erase(size_type const first,
+	size_type const last)
+{
+	assert(first <= last);
+	assert(last <= keys_.size());
+
+	if (first == last)
+	{
+		return;
+	}
+
+	for (size_type i{ first }; i != last; ++i)
+	{
+		erase_slot(slot_of(i));
+	}
+
+	elements_.alloc_.deallocate(first, last);
+	keys_.erase(keys_.begin() + first, keys_.begin() + last);
+
+	// everything behind the erased range moved forward by the same count
+	size_type const n{ last - first };
+	for (auto& s : slots_)
+	{
+		if (s != npos && s >= last)
+		{
+			s -= n;
+		}
+	}
+}
+
+template<class B, class Projection, class Hash, class KeyEqual>
+inline void gut::indexed_polymorphic_vector<B, Projection, Hash, KeyEqual>::pop_back()
+{
+	assert(!keys_.empty());
+
+	erase_slot(slot_of(keys_.size() - 1));
+	elements_.pop_back();
+	keys_.pop_back();
+}
+
+template<class B, class Projection, class Hash, class KeyEqual>
+inline void gut::indexed_polymorphic_vector<B, Projection, Hash, KeyEqual>::clear()
+{
+	elements_.clear();
+	keys_.clear();
+	std::fill(slots_.begin(), slots_.end(), npos);
+}
+
+template<class B, class Projection, class Hash, class KeyEqual>
+template<class Compare>
+void gut::indexed_polymorphic_vector<B, Projection, Hash, KeyEqual>::sort(Compare comp)
+{
+	size_type const n{ keys_.size() };
+
+	std::vector<size_type> order(n);
+	std::iota(order.begin(), order.end(), size_type{ 0 });
+	std::sort(order.begin(), order.end(), [this, &comp](size_type const x, size_type const y)
+	{
+		return comp(elements_[x], elements_[y]);
+	});
+
+	// handles and keys are permuted alike; every position changes, so the
+	// table is filled again rather than patched
+	auto& handles = elements_.alloc_.handles_;
+	std::vector<gut::polymorphic_handle> sorted_handles(n);
+	std::vector<key_type> sorted_keys;
+	sorted_keys.reserve(n);
+
+	for (size_type i{ 0 }; i != n; ++i)
+	{
+		sorted_handles[i] = std::move(handles[order[i]]);
+		sorted_keys.push_back(std::move(keys_[order[i]]));
+	}
+
+	handles.swap(sorted_handles);
+	keys_.swap(sorted_keys);
+	elements_.alloc_.reordered();
+	rebuild();
+}
+
+template<class B, class Projection, class Hash, class KeyEqual>
+inline void gut::indexed_polymorphic_vector<B, Projection, Hash, KeyEqual>::compact_in_order()
+{
+	elements_.compact_in_order();
+}
+
+template<class B, class Projection, class Hash, class KeyEqual>
+inline typename gut::indexed_polymorphic_vector<B, Projection, Hash, KeyEqual>::size_type
+gut::indexed_polymorphic_vector<B, Projection, Hash, KeyEqual>::compact(gut::packing const p)
+{
+	// compaction moves objects but keeps positions, and with them the index
+	return elements_.compact(p);
+}
+
+template<class B, class Projection, class Hash, class KeyEqual>
+inline typename gut::indexed_polymorphic_vector<B, Projection, Hash, KeyEqual>::size_type
+gut::indexed_polymorphic_vector<B, Projection, Hash, KeyEqual>::compact_step(size_type const byte_budget)
+{
+	return elements_.compact_step(byte_budget);
+}
+
+template<class B, class Projection, class Hash, class KeyEqual>
+void gut::indexed_polymorphic_vector<B, Projection, Hash, KeyEqual>::rekey(size_type const i)
+{
+	key_type k{ project(elements_[i]) };
+	if (equal_(k, keys_[i]))
+	{
+		return;
+	}
+
+	erase_slot(slot_of(i));
+	std::swap(keys_[i], k);
+	try
+	{
+		insert(i);
+	}
+	catch (...)
+	{
+		// the new key is taken; the element stays indexed under the old one
+		std::swap(keys_[i], k);
+		insert(i);
+		throw;
+	}
+}
+//////////////////////////////////////////////////////////////////////////////////
+// lookup
+//////////////////////////////////////////////////////////////////////////////////
+template<class B, class Projection, class Hash, class KeyEqual>
+inline typename gut::indexed_polymorphic_vector<B, Projection, Hash, KeyEqual>::pointer
+gut::indexed_polymorphic_vector<B, Projection, Hash, KeyEqual>::find(key_type const& key) noexcept
+{
+	size_type const i{ position(key) };
+	return i == npos ? nullptr : &elements_[i];
+}
+
+template<class B, class Projection, class Hash, class KeyEqual>
+inline typename gut::indexed_polymorphic_vector<B, Projection, Hash, KeyEqual>::const_pointer
+gut::indexed_polymorphic_vector<B, Projection, Hash, KeyEqual>::find(key_type const& key) const noexcept
+{
+	size_type const i{ position(key) };
+	return i == npos ? nullptr : &elements_[i];
+}
+
+template<class B, class Projection, class Hash, class KeyEqual>
+inline typename gut::indexed_polymorphic_vector<B, Projection, Hash, KeyEqual>::size_type
+gut::indexed_polymorphic_vector<B, Projection, Hash, KeyEqual>::position(key_type const& key) const noexcept
+{
+	return slots_.empty() ? npos : slots_[probe(key)];
+}
+
+template<class B, class Projection, class Hash, class KeyEqual>
+inline bool gut::indexed_polymorphic_vector<B, Projection, Hash, KeyEqual>::contains(key_type const& key) const noexcept
+{
+	return position(key) != npos;
+}
+//////////////////////////////////////////////////////////////////////////////////
+// element access
+//////////////////////////////////////////////////////////////////////////////////
+template<class B, class Projection, class Hash, class KeyEqual>
+inline typename gut::indexed_polymorphic_vector<B, Projection, Hash, KeyEqual>::reference
+gut::indexed_polymorphic_vector<B, Projection, Hash, KeyEqual>::operator[](size_type const i) noexcept
+{
+	return elements_[i];
+}
+
+template<class B, class Projection, class Hash, class KeyEqual>
+inline typename gut::indexed_polymorphic_vector<B, Projection, Hash, KeyEqual>::const_reference
+gut::indexed_polymorphic_vector<B, Projection, Hash, KeyEqual>::operator[](size_type const i) const noexcept
+{
+	return elements_[i];
+}
+
+template<class B, class Projection, class Hash, class KeyEqual>
+inline typename gut::indexed_polymorphic_vector<B, Projection, Hash, KeyEqual>::reference
+gut::indexed_polymorphic_vector<B, Projection, Hash, KeyEqual>::at(size_type const i)
+{
+	return elements_.at(i);
+}
+
+template<class B, class Projection, class Hash, class KeyEqual>
+inline typename gut::indexed_polymorphic_vector<B, Projection, Hash, KeyEqual>::const_reference
+gut::indexed_polymorphic_vector<B, Projection, Hash, KeyEqual>::at(size_type const i) const
+{
+	return elements_.at(i);
+}
+
+template<class B, class Projection, class Hash, class KeyEqual>
+inline typename gut::indexed_polymorphic_vector<B, Projection, Hash, KeyEqual>::vector_type const&
+gut::indexed_polymorphic_vector<B, Projection, Hash, KeyEqual>::elements() const noexcept
+{
+	return elements_;
+}
+
+template<class B, class Projection, class Hash, class KeyEqual>
+inline typename gut::indexed_polymorphic_vector<B, Projection, Hash, KeyEqual>::key_type const&
+gut::indexed_polymorphic_vector<B, Projection, Hash, KeyEqual>::key(size_type const i) const noexcept
+{
+	return keys_[i];
+}
+//////////////////////////////////////////////////////////////////////////////////
+// capacity
+//////////////////////////////////////////////////////////////////////////////////
+template<class B, class Projection, class Hash, class KeyEqual>
+inline typename gut::indexed_polymorphic_vector<B, Projection, Hash, KeyEqual>::size_type
+gut::indexed_polymorphic_vector<B, Projection, Hash, KeyEqual>::size() const noexcept
+{
+	return keys_.size();
+}
+
+template<class B, class Projection, class Hash, class KeyEqual>
+inline bool gut::indexed_polymorphic_vector<B, Projection, Hash, KeyEqual>::empty() const noexcept
+{
+	return keys_.empty();
+}
+///////////////////////////////////////////////////////////////////////////////
+// private member functions
+///////////////////////////////////////////////////////////////////////////////
+template<class B, class Projection, class Hash, class KeyEqual>
+inline typename gut::indexed_polymorphic_vector<B, Projection, Hash, KeyEqual>::key_type
+gut::indexed_polymorphic_vector<B, Projection, Hash, KeyEqual>::project(B const& value) const
+{
+	return detail::project(projection_, value);
+}
+
+template<class B, class Projection, class Hash, class KeyEqual>
+inline typename gut::indexed_polymorphic_vector<B, Projection, Hash, KeyEqual>::size_type
+gut::indexed_polymorphic_vector<B, Projection, Hash, KeyEqual>::home(key_type const& key) const noexcept
+{
+	// std::hash is the identity for integers on common implementations; a
+	// multiplicative mix spreads strided ids over the low bits the mask keeps
+	std::uint64_t const h{ static_cast<std::uint64_t>(hash_(key)) * 0x9E3779B97F4A7C15ull };
+	return static_cast<size_type>(h ^ (h >> 32)) & (slots_.size() - 1);
+}
+
+template<class B, class Projection, class Hash, class KeyEqual>
+inline typename gut::indexed_polymorphic_vector<B, Projection, Hash, KeyEqual>::size_type
+gut::indexed_polymorphic_vector<B, Projection, Hash, KeyEqual>::slot_of(size_type const i) const noexcept
+{
+	size_type const mask{ slots_.size() - 1 };
+	size_type s{ home(keys_[i]) };
+	while (slots_[s] != i)
+	{
+		assert(slots_[s] != npos);
+		s = (s + 1) & mask;
+	}
+	return s;
+}
+
+template<class B, class Projection, class Hash, class KeyEqual>
+inline typename gut::indexed_polymorphic_vector<B, Projection, Hash, KeyEqual>::size_type
+gut::indexed_polymorphic_vector<B, Projection, Hash, KeyEqual>::probe(key_type const& key) const noexcept
+{
+	size_type const mask{ slots_.size() - 1 };
+	size_type s{ home(key) };
+	while (slots_[s] != npos && !equal_(keys_[slots_[s]], key))
+	{
+		s = (s + 1) & mask;
+	}
+	return s;
+}
+
+template<class B, class Projection, class Hash, class KeyEqual>
+void gut::indexed_polymorphic_vector<B, Projection, Hash, KeyEqual>::erase_slot(size_type s) noexcept
+{
+	size_type const mask{ slots_.size() - 1 };
+	for (size_type t{ (s + 1) & mask }; slots_[t] != npos; t = (t + 1) & mask)
+	{
+		// an entry may fill the hole if the hole lies on its probe path, that
+		// is no further from its home slot than the entry itself
+		size_type const h{ home(keys_[slots_[t]]) };
+		if (((t - h) & mask) >= ((t - s) & mask))
+		{
+			slots_[s] = slots_[t];
+			s = t;
+		}
+	}
+	slots_[s] = npos;
+}
+
+template<class B, class Projection, class Hash, class KeyEqual>
+void gut::indexed_polymorphic_vector<B, Projection, Hash, KeyEqual>::insert(size_type const i)
+{
+	size_type const s{ probe(keys_[i]) };
+	if (slots_[s] != npos)
+	{
+		throw std::invalid_argument
+		{
+			"indexed_polymorphic_vector<B, Projection>::insert( size_type const i );\n"
+			"duplicate key"
+		};
+	}
+	slots_[s] = i;
+}
+
+template<class B, class Projection, class Hash, class KeyEqual>
+void gut::indexed_polymorphic_vector<B, Projection, Hash, KeyEqual>::reserve_slots(size_type const n)
+{
+	// at most 3/4 of the slots are used, which keeps probe runs short
+	if (n * 4 <= slots_.size() * 3)
+	{
+		return;
+	}
+
+	size_type cap{ slots_.empty() ? size_type{ 16 } : slots_.size() };
+	while (n * 4 > cap * 3)
+	{
+		cap *= 2;
+	}
+
+	std::vector<size_type> slots(cap, npos);
+	slots_.swap(slots);
+	rebuild();
+}
+
+template<class B, class Projection, class Hash, class KeyEqual>
+void gut::indexed_polymorphic_vector<B, Projection, Hash, KeyEqual>::rebuild()
+{
+	std::fill(slots_.begin(), slots_.end(), npos);
+	for (size_type i{ 0 }, sz{ keys_.size() }; i != sz; ++i)
+	{
+		slots_[probe(keys_[i])] = i;
+	}
+}
+#endif // GUT_INDEXED_POLYMORPHIC_VECTOR_H
@@ -0,0 +1,191 @@
+#ifndef GUT_INTERFACE_VIEW_H
+#define GUT_INTERFACE_VIEW_H
+
+#include "polymorphic_handle.h"
+#include <cassert>
+#include <cstddef>
+#include <iterator>
+#include <type_traits>
+#include <typeinfo>
+#include <vector>
+
+namespace gut
+{
+	template<class I, bool is_const> class interface_view;
+
+	// forward iterator over the elements of a polymorphic_vector<B> that
+	// implement the interface I, given as I&. it refers to the cache of the
+	// interface_view it came from and is only valid as long as that view
+	template<class I, bool is_const>
+	class interface_view_iterator final
+	{
+	public:
+		using iterator_category = std::forward_iterator_tag;
+		using value_type = I;
+		using difference_type = std::ptrdiff_t;
+		using reference = std::conditional_t<is_const, I const&, I&>;
+		using pointer = std::conditional_t<is_const, I const*, I*>;
+
+		reference operator*() const noexcept
+		{
+			return *get();
+		}
+
+		pointer operator->() const noexcept
+		{
+			return get();
+		}
+
+		interface_view_iterator& operator++()
+		{
+			assert(cur_ != end_);
+			++cur_;
+			skip();
+			return *this;
+		}
+
+		interface_view_iterator operator++(int)
+		{
+			auto it = *this;
+			++*this;
+			return it;
+		}
+
+		friend bool operator==(interface_view_iterator const& lhs,
+			interface_view_iterator const& rhs) noexcept
+		{
+			return lhs.cur_ == rhs.cur_;
+		}
+
+		friend bool operator!=(interface_view_iterator const& lhs,
+			interface_view_iterator const& rhs) noexcept
+		{
+			return lhs.cur_ != rhs.cur_;
+		}
+
+	private:
+		friend class interface_view<I, is_const>;
+
+		using view_type = interface_view<I, is_const>;
+		using handle_pointer = typename view_type::handle_pointer;
+
+		interface_view_iterator(view_type const& view, handle_pointer cur)
+			: view_{ &view }
+			, cur_{ cur }
+			, end_{ view.last_ }
+			, offset_{ 0 }
+		{
+			skip();
+		}
+
+		pointer get() const noexcept
+		{
+			assert(cur_ != end_);
+			using byte_pointer = std::conditional_t<is_const, unsigned char const*, unsigned char*>;
+			return reinterpret_cast<pointer>(static_cast<byte_pointer>((*cur_)->src()) + offset_);
+		}
+
+		// stops at the next element implementing I and keeps its offset
+		void skip()
+		{
+			for (; cur_ != end_; ++cur_)
+			{
+				auto const& c = view_->cast(*cur_);
+				if (c.implements)
+				{
+					offset_ = c.offset;
+					return;
+				}
+			}
+		}
+
+		view_type const* view_;
+		handle_pointer cur_;
+		handle_pointer end_;
+		std::ptrdiff_t offset_;
+	};
+
+	// the result of polymorphic_vector<B>::view<I>(), for range-based for.
+	//
+	// the first element of every concrete type met goes through dynamic_cast
+	// once to find where its I lives relative to the object, or that it has
+	// none; every other element of that type is then adjusted by the cached
+	// offset, with only its handle read to find the type
+	template<class I, bool is_const>
+	class interface_view
+	{
+	public:
+		using iterator = gut::interface_view_iterator<I, is_const>;
+
+		using handle_pointer = std::conditional_t
+		<
+			is_const,
+			gut::polymorphic_handle const*,
+			gut::polymorphic_handle*
+		>;
+
+		using caster = I const* (*)(void const* src);
+
+		interface_view(handle_pointer first, handle_pointer last, caster cast) noexcept
+			: first_{ first }
+			, last_{ last }
+			, cast_{ cast }
+			, last_hit_{ 0 }
+		{}
+
+		iterator begin() const
+		{
+			return{ *this, first_ };
+		}
+
+		iterator end() const
+		{
+			return{ *this, last_ };
+		}
+
+	private:
+		friend class gut::interface_view_iterator<I, is_const>;
+
+		struct cross_cast
+		{
+			std::type_info const* type;
+			std::ptrdiff_t offset;
+			bool implements;
+		};
+
+		// elements of a type tend to come in runs, so the last type found is
+		// tried before the others
+		cross_cast const& cast(gut::polymorphic_handle const& h) const
+		{
+			std::type_info const* const type{ &h->type() };
+			if (last_hit_ < casts_.size() && casts_[last_hit_].type == type)
+			{
+				return casts_[last_hit_];
+			}
+
+			for (std::size_t i{ 0 }; i != casts_.size(); ++i)
+			{
+				if (casts_[i].type == type)
+				{
+					last_hit_ = i;
+					return casts_[i];
+				}
+			}
+
+			auto const src = static_cast<unsigned char const*>(h->src());
+			auto const p = reinterpret_cast<unsigned char const*>(cast_(src));
+
+			last_hit_ = casts_.size();
+			casts_.push_back({ type, p ? p - src : 0, p != nullptr });
+			return casts_.back();
+		}
+
+		handle_pointer first_;
+		handle_pointer last_;
+		caster cast_;
+
+		mutable std::vector<cross_cast> casts_;
+		mutable std::size_t last_hit_;
+	};
+}
+#endif // GUT_INTERFACE_VIEW_H
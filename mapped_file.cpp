@@ -0,0 +1,166 @@
+#include "mapped_file.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <new>
+#include <stdexcept>
+#include <string>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define GUT_HAS_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using byte = gut::mapped_file::byte;
+using size_type = gut::mapped_file::size_type;
+
+namespace
+{
+	constexpr size_type buffer_alignment{ 4096 };
+
+	[[noreturn]] void throw_open_error(char const* path)
+	{
+		throw std::runtime_error
+		{
+			std::string{ "mapped_file::mapped_file( char const* path );\n" } +
+			"unable to read " + path
+		};
+	}
+}
+//////////////////////////////////////////////////////////////////////////////////
+// destructor
+//////////////////////////////////////////////////////////////////////////////////
+gut::mapped_file::~mapped_file() noexcept
+{
+	release();
+}
+//////////////////////////////////////////////////////////////////////////////////
+// constructors/assignment
+//////////////////////////////////////////////////////////////////////////////////
+gut::mapped_file::mapped_file(char const* path)
+	: data_{ nullptr }
+	, size_{ 0 }
+	, buffer_{ nullptr }
+{
+#ifdef GUT_HAS_MMAP
+	int fd{ ::open(path, O_RDONLY) };
+	if (fd < 0)
+	{
+		throw_open_error(path);
+	}
+
+	struct stat st;
+	if (::fstat(fd, &st) != 0)
+	{
+		::close(fd);
+		throw_open_error(path);
+	}
+
+	size_ = static_cast<size_type>(st.st_size);
+	if (size_ != 0)
+	{
+		void* p{ ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0) };
+		if (p == MAP_FAILED)
+		{
+			::close(fd);
+			throw_open_error(path);
+		}
+		data_ = static_cast<byte const*>(p);
+	}
+	::close(fd);
+#else
+	std::FILE* f{ std::fopen(path, "rb") };
+	if (!f)
+	{
+		throw_open_error(path);
+	}
+
+	std::fseek(f, 0, SEEK_END);
+	long const end{ std::ftell(f) };
+	std::fseek(f, 0, SEEK_SET);
+
+	if (end < 0)
+	{
+		std::fclose(f);
+		throw_open_error(path);
+	}
+
+	size_ = static_cast<size_type>(end);
+	buffer_ = std::malloc(size_ + buffer_alignment);
+	if (!buffer_)
+	{
+		std::fclose(f);
+		throw std::bad_alloc{};
+	}
+
+	// keep the same alignment guarantees as a mapping
+	auto aligned = (reinterpret_cast<std::uintptr_t>(buffer_) + buffer_alignment - 1)
+		& ~(buffer_alignment - 1);
+	data_ = reinterpret_cast<byte const*>(aligned);
+
+	size_type const read{ std::fread(const_cast<byte*>(data_), 1, size_, f) };
+	std::fclose(f);
+
+	if (read != size_)
+	{
+		release();
+		throw_open_error(path);
+	}
+#endif
+}
+
+gut::mapped_file::mapped_file(mapped_file&& other) noexcept
+	: data_{ other.data_ }
+	, size_{ other.size_ }
+	, buffer_{ other.buffer_ }
+{
+	other.data_ = nullptr;
+	other.size_ = 0;
+	other.buffer_ = nullptr;
+}
+
+gut::mapped_file& gut::mapped_file::operator=(mapped_file&& other) noexcept
+{
+	if (this != &other)
+	{
+		release();
+		data_ = other.data_;
+		size_ = other.size_;
+		buffer_ = other.buffer_;
+		other.data_ = nullptr;
+		other.size_ = 0;
+		other.buffer_ = nullptr;
+	}
+	return *this;
+}
+//////////////////////////////////////////////////////////////////////////////////
+// member access
+//////////////////////////////////////////////////////////////////////////////////
+byte const* gut::mapped_file::data() const noexcept
+{
+	return data_;
+}
+
+size_type gut::mapped_file::size() const noexcept
+{
+	return size_;
+}
+//////////////////////////////////////////////////////////////////////////////////
+// private member functions
+//////////////////////////////////////////////////////////////////////////////////
+void gut::mapped_file::release() noexcept
+{
+#ifdef GUT_HAS_MMAP
+	if (data_)
+	{
+		::munmap(const_cast<byte*>(data_), size_);
+	}
+#endif
+	std::free(buffer_);
+	data_ = nullptr;
+	size_ = 0;
+	buffer_ = nullptr;
+}
\ No newline at end of file
@@ -0,0 +1,37 @@
+#ifndef GUT_MAPPED_FILE_H
+#define GUT_MAPPED_FILE_H
+
+#include <cstddef>
+
+namespace gut
+{
+	// read-only view of a whole file. the file is memory-mapped where the
+	// platform supports it and read into a page-aligned buffer otherwise.
+	class mapped_file
+	{
+	public:
+		using byte = unsigned char;
+		using size_type = std::size_t;
+
+		~mapped_file() noexcept;
+
+		explicit mapped_file(char const* path);
+
+		mapped_file(mapped_file&& other) noexcept;
+		mapped_file& operator=(mapped_file&& other) noexcept;
+
+		mapped_file(mapped_file const&) = delete;
+		mapped_file& operator=(mapped_file const&) = delete;
+
+		byte const* data() const noexcept;
+		size_type size() const noexcept;
+
+	private:
+		void release() noexcept;
+
+		byte const* data_;
+		size_type size_;
+		void* buffer_;
+	};
+}
+#endif // GUT_MAPPED_FILE_H
\ No newline at end of file
@@ -2,9 +2,9 @@
 #define GUT_POLYMORPHIC_HANDLE_H
 
 #include "handle_base.h"
-#include "handle.h"
 #include <new>
 #include <algorithm>
+#include <cstdint>
 #include <stdexcept>
 
 namespace gut
@@ -28,6 +28,7 @@ namespace gut
 
 		polymorphic_handle() noexcept
 			: is_initialized_{ false }
+			, type_{ gut::no_type_index }
 		{}
 
 		polymorphic_handle(polymorphic_handle&& other) = default;
@@ -36,9 +37,11 @@ namespace gut
 		polymorphic_handle(polymorphic_handle const&) = delete;
 		polymorphic_handle& operator=(polymorphic_handle const&) = delete;
 
+		// registers T with gut::type_index() the first time a T is held
 		template<class T>
-		explicit polymorphic_handle(gut::handle<T>&& h) noexcept
+		explicit polymorphic_handle(gut::handle<T>&& h)
 			: is_initialized_{ true }
+			, type_{ gut::type_index_of<T>() }
 		{
 			::new (&h_) gut::handle<T>{ std::move(h) };
 		}
@@ -55,6 +58,20 @@ namespace gut
 			return reinterpret_cast<const_pointer>(&h_);
 		}
 
+		// the gut::type_index() of the object's type
+		std::uint32_t type_index() const noexcept
+		{
+			return type_;
+		}
+
+		// whether the object is exactly a T; compares type indices, so it
+		// reads the handle only and never the object
+		template<class T>
+		bool holds() const noexcept
+		{
+			return type_ == gut::find_type_index_of<T>();
+		}
+
 	private:
 		using storage_t = std::aligned_storage_t
 		<
@@ -75,6 +92,8 @@ namespace gut
 
 		storage_t h_;
 		bool is_initialized_;
+		// in what would be padding, so a handle takes no more room
+		std::uint32_t type_;
 	};
 }
 #endif // GUT_POLYMORPHIC_HANDLE_H
\ No newline at end of file
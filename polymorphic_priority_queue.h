@@ -0,0 +1,380 @@
+#ifndef GUT_POLYMORPHIC_PRIORITY_QUEUE_H
+#define GUT_POLYMORPHIC_PRIORITY_QUEUE_H
+
+#include "contiguous_allocator.h"
+#include "polymorphic_vector.h"
+#include <algorithm>
+#include <cassert>
+#include <functional>
+#include <iterator>
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace gut
+{
+	// a max-heap of objects of any type derived from B, ordered by Compare on
+	// B const&, like std::priority_queue. the objects live in one arena and
+	// never move for the heap's sake: push() and pop() sift the handles only.
+	//
+	// pop() destroys the top element where it is; unless it happens to be the
+	// last object of the arena its bytes become a hole, and if it is, the end
+	// of the arena also gives back the hole it then borders on. once the holes
+	// take up more than half of the used bytes the arena is compacted in heap
+	// order, which keeps the amortized cost of a pop bounded by the bytes it
+	// freed
+	template<class B, class Compare = std::less<>>
+	class polymorphic_priority_queue
+	{
+	public:
+		using byte = gut::contiguous_allocator::byte;
+
+		using value_type = B;
+		using const_reference = value_type const&;
+		using const_pointer = value_type const*;
+		using value_compare = Compare;
+		using size_type = gut::contiguous_allocator::size_type;
+
+		// destructor
+		~polymorphic_priority_queue();
+
+		// constructors
+		explicit polymorphic_priority_queue(Compare const& comp = Compare{},
+			size_type const capacity = 0,
+			gut::arena_backing const b = gut::arena_backing::heap());
+
+		polymorphic_priority_queue(polymorphic_priority_queue&&) = default;
+		polymorphic_priority_queue& operator=(polymorphic_priority_queue&&) = default;
+
+		// a copy holds the elements in heap order, without holes
+		polymorphic_priority_queue(polymorphic_priority_queue const& other);
+		polymorphic_priority_queue& operator=(polymorphic_priority_queue const& other);
+
+		// modifiers
+		template<class D, gut::enable_if_derived_t<B, D> = 0>
+		void push(D&& value);
+
+		template<class D, class... Args, gut::enable_if_derived_t<B, D> = 0>
+		void emplace(Args&&... args);
+
+		void pop();
+		void clear();
+		void swap(polymorphic_priority_queue& other) noexcept;
+
+		// closes every hole now and returns the number of bytes reclaimed
+		size_type compact();
+
+		// element access
+		const_reference top() const noexcept;
+
+		// capacity
+		size_type size() const noexcept;
+		bool empty() const noexcept;
+
+		// instrumentation
+		gut::arena_stats stats() const;
+		size_type footprint() const noexcept;
+
+	private:
+		static const_reference object(gut::polymorphic_handle const& h) noexcept;
+
+		// the heap order on handles, through the objects they refer to
+		auto heap_order() const noexcept;
+
+		// byte offsets [first, last) in the arena that no live element covers
+		struct hole
+		{
+			size_type first;
+			size_type last;
+		};
+
+		// records a freed block, merging it with the holes it borders on
+		void add_hole(size_type const first, size_type const last);
+
+		// rebuilds the holes from the blocks of the live elements
+		void find_holes();
+
+		gut::contiguous_allocator alloc_;
+		Compare comp_;
+		// sorted, and never two that touch
+		std::vector<hole> holes_;
+		size_type hole_bytes_;
+	};
+}
+//////////////////////////////////////////////////////////////////////////////////
+// destructor
+//////////////////////////////////////////////////////////////////////////////////
+template<class B, class Compare>
+inline gut::polymorphic_priority_queue<B, Compare>::~polymorphic_priority_queue()
+{
+	alloc_.destroy_elements(0, alloc_.handles_.size());
+}
+//////////////////////////////////////////////////////////////////////////////////
+// constructors/assignment
+//////////////////////////////////////////////////////////////////////////////////
+template<class B, class Compare>
+inline gut::polymorphic_priority_queue<B, Compare>::polymorphic_priority_queue(
+	Compare const& comp, size_type const capacity, gut::arena_backing const b)
+	: alloc_{ capacity, gut::placement::packed(), b }
+	, comp_(comp)
+	, hole_bytes_{ 0 }
+{}
+
+template<class B, class Compare>
+inline gut::polymorphic_priority_queue<B, Compare>::polymorphic_priority_queue(
+	polymorphic_priority_queue const& other)
+	: alloc_{ other.alloc_ }
+	, comp_(other.comp_)
+	, hole_bytes_{ 0 }
+{}
+
+template<class B, class Compare>
+inline gut::polymorphic_priority_queue<B, Compare>&
+gut::polymorphic_priority_queue<B, Compare>::operator=(polymorphic_priority_queue const& other)
+{
+	if (this != &other)
+	{
+		alloc_ = other.alloc_;
+		comp_ = other.comp_;
+		holes_.clear();
+		hole_bytes_ = 0;
+	}
+	return *this;
+}
+//////////////////////////////////////////////////////////////////////////////////
+// modifiers
+//////////////////////////////////////////////////////////////////////////////////
+template<class B, class Compare>
+template<class D, gut::enable_if_derived_t<B, D>>
+inline void gut::polymorphic_priority_queue<B, Compare>::push(D&& value)
+{
+	emplace<std::decay_t<D>>(std::forward<D>(value));
+}
+
+template<class B, class Compare>
+template<class D, class... Args, gut::enable_if_derived_t<B, D>>
+inline void gut::polymorphic_priority_queue<B, Compare>::emplace(Args&&... args)
+{
+	size_type const growth_count{ alloc_.counters_.growth_count };
+	D* p{ alloc_.allocate<D>() };
+
+	try
+	{
+		// growth closed the holes or moved them along with the elements
+		if (alloc_.counters_.growth_count != growth_count)
+		{
+			find_holes();
+		}
+		::new (p) D{ std::forward<Args>(args)... };
+	}
+	catch (...)
+	{
+		alloc_.offset_ = reinterpret_cast<byte*>(alloc_.handles_.back()->blk()) - alloc_.data_;
+		alloc_.handles_.pop_back();
+		throw;
+	}
+
+	std::push_heap(alloc_.handles_.begin(), alloc_.handles_.end(), heap_order());
+	alloc_.in_order_ = alloc_.handles_.size() == 1;
+}
+
+template<class B, class Compare>
+inline void gut::polymorphic_priority_queue<B, Compare>::pop()
+{
+	assert(!empty());
+
+	auto& handles = alloc_.handles_;
+	std::pop_heap(handles.begin(), handles.end(), heap_order());
+	alloc_.in_order_ = false;
+
+	auto const& h = handles.back();
+	auto const blk = reinterpret_cast<byte*>(h->blk());
+	auto const end = reinterpret_cast<byte*>(h->src()) + h->size();
+	bool const last{ end == alloc_.data_ + alloc_.offset_ };
+
+	alloc_.deallocate_back();
+
+	if (handles.empty())
+	{
+		clear();
+		return;
+	}
+
+	if (last)
+	{
+		// holes never touch, so at most one borders on the new end
+		if (!holes_.empty() && holes_.back().last == alloc_.offset_)
+		{
+			alloc_.offset_ = holes_.back().first;
+			hole_bytes_ -= holes_.back().last - holes_.back().first;
+			holes_.pop_back();
+		}
+	}
+	else
+	{
+		add_hole(blk - alloc_.data_, end - alloc_.data_);
+	}
+
+	if (hole_bytes_ > alloc_.offset_ - hole_bytes_)
+	{
+		compact();
+	}
+}
+
+template<class B, class Compare>
+inline void gut::polymorphic_priority_queue<B, Compare>::clear()
+{
+	alloc_.clear();
+	holes_.clear();
+	hole_bytes_ = 0;
+}
+
+template<class B, class Compare>
+inline void gut::polymorphic_priority_queue<B, Compare>::swap(polymorphic_priority_queue& other) noexcept
+{
+	using std::swap;
+	alloc_.swap(other.alloc_);
+	swap(comp_, other.comp_);
+	swap(holes_, other.holes_);
+	swap(hole_bytes_, other.hole_bytes_);
+}
+
+template<class B, class Compare>
+inline typename gut::polymorphic_priority_queue<B, Compare>::size_type
+gut::polymorphic_priority_queue<B, Compare>::compact()
+{
+	holes_.clear();
+	hole_bytes_ = 0;
+	return alloc_.compact(gut::packing::in_order);
+}
+//////////////////////////////////////////////////////////////////////////////////
+// element access
+//////////////////////////////////////////////////////////////////////////////////
+template<class B, class Compare>
+inline typename gut::polymorphic_priority_queue<B, Compare>::const_reference
+gut::polymorphic_priority_queue<B, Compare>::top() const noexcept
+{
+	assert(!empty());
+	return object(alloc_.handles_.front());
+}
+//////////////////////////////////////////////////////////////////////////////////
+// capacity
+//////////////////////////////////////////////////////////////////////////////////
+template<class B, class Compare>
+inline typename gut::polymorphic_priority_queue<B, Compare>::size_type
+gut::polymorphic_priority_queue<B, Compare>::size() const noexcept
+{
+	return alloc_.handles_.size();
+}
+
+template<class B, class Compare>
+inline bool gut::polymorphic_priority_queue<B, Compare>::empty() const noexcept
+{
+	return alloc_.handles_.empty();
+}
+//////////////////////////////////////////////////////////////////////////////////
+// instrumentation
+//////////////////////////////////////////////////////////////////////////////////
+template<class B, class Compare>
+inline gut::arena_stats gut::polymorphic_priority_queue<B, Compare>::stats() const
+{
+	return alloc_.stats();
+}
+
+template<class B, class Compare>
+inline typename gut::polymorphic_priority_queue<B, Compare>::size_type
+gut::polymorphic_priority_queue<B, Compare>::footprint() const noexcept
+{
+	return alloc_.footprint();
+}
+//////////////////////////////////////////////////////////////////////////////////
+// private functions
+//////////////////////////////////////////////////////////////////////////////////
+template<class B, class Compare>
+inline typename gut::polymorphic_priority_queue<B, Compare>::const_reference
+gut::polymorphic_priority_queue<B, Compare>::object(gut::polymorphic_handle const& h) noexcept
+{
+	return *reinterpret_cast<const_pointer>(h->src());
+}
+
+template<class B, class Compare>
+inline auto gut::polymorphic_priority_queue<B, Compare>::heap_order() const noexcept
+{
+	return [this](gut::polymorphic_handle const& x, gut::polymorphic_handle const& y)
+	{
+		return comp_(object(x), object(y));
+	};
+}
+
+template<class B, class Compare>
+inline void gut::polymorphic_priority_queue<B, Compare>::add_hole(size_type const first,
+	size_type const last)
+{
+	auto next = std::lower_bound(holes_.begin(), holes_.end(), first,
+		[](hole const& h, size_type const at)
+	{
+		return h.first < at;
+	});
+
+	bool const joins_prev{ next != holes_.begin() && std::prev(next)->last == first };
+	bool const joins_next{ next != holes_.end() && next->first == last };
+
+	if (joins_prev && joins_next)
+	{
+		std::prev(next)->last = next->last;
+		holes_.erase(next);
+	}
+	else if (joins_prev)
+	{
+		std::prev(next)->last = last;
+	}
+	else if (joins_next)
+	{
+		next->first = first;
+	}
+	else
+	{
+		holes_.insert(next, hole{ first, last });
+	}
+	hole_bytes_ += last - first;
+}
+
+template<class B, class Compare>
+inline void gut::polymorphic_priority_queue<B, Compare>::find_holes()
+{
+	// offsets from before a growth must not outlive a failed rebuild
+	holes_.clear();
+	hole_bytes_ = 0;
+
+	std::vector<hole> blocks;
+	blocks.reserve(alloc_.handles_.size());
+	for (auto const& h : alloc_.handles_)
+	{
+		auto const blk = reinterpret_cast<byte*>(h->blk());
+		auto const end = reinterpret_cast<byte*>(h->src()) + h->size();
+		blocks.push_back(hole{ size_type(blk - alloc_.data_), size_type(end - alloc_.data_) });
+	}
+	std::sort(blocks.begin(), blocks.end(), [](hole const& x, hole const& y)
+	{
+		return x.first < y.first;
+	});
+
+	size_type at{ 0 };
+	for (auto const& b : blocks)
+	{
+		if (b.first > at)
+		{
+			holes_.push_back(hole{ at, b.first });
+			hole_bytes_ += b.first - at;
+		}
+		at = std::max(at, b.last);
+	}
+}
+
+template<class B, class Compare>
+inline void swap(gut::polymorphic_priority_queue<B, Compare>& x,
+	gut::polymorphic_priority_queue<B, Compare>& y) noexcept
+{
+	x.swap(y);
+}
+#endif // GUT_POLYMORPHIC_PRIORITY_QUEUE_H
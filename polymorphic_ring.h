@@ -0,0 +1,692 @@
+#ifndef GUT_POLYMORPHIC_RING_H
+#define GUT_POLYMORPHIC_RING_H
+
+#include "arena_backing.h"
+#include "contiguous_allocator.h"
+#include "polymorphic_vector.h"
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <iterator>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace gut
+{
+	template<class B> class polymorphic_ring;
+
+	// iterator over a polymorphic_ring in FIFO order
+	template<class B, bool is_const>
+	class polymorphic_ring_iterator final
+	{
+	public:
+		using iterator_category = std::random_access_iterator_tag;
+		using value_type = B;
+		using difference_type = std::ptrdiff_t;
+		using pointer = std::conditional_t<is_const, B const*, B*>;
+		using reference = std::conditional_t<is_const, B const&, B&>;
+
+		polymorphic_ring_iterator() noexcept
+			: ring_{ nullptr }
+			, i_{ 0 }
+		{}
+
+		template
+		<
+			bool other_const,
+			std::enable_if_t<is_const && !other_const, int> = 0
+		>
+		polymorphic_ring_iterator(polymorphic_ring_iterator<B, other_const> const& it) noexcept
+			: ring_{ it.ring_ }
+			, i_{ it.i_ }
+		{}
+
+		reference operator*() const noexcept
+		{
+			return (*ring_)[i_];
+		}
+
+		pointer operator->() const noexcept
+		{
+			return &(*ring_)[i_];
+		}
+
+		reference operator[](difference_type const n) const noexcept
+		{
+			return (*ring_)[i_ + n];
+		}
+
+		polymorphic_ring_iterator& operator++() noexcept
+		{
+			++i_;
+			return *this;
+		}
+
+		polymorphic_ring_iterator& operator--() noexcept
+		{
+			--i_;
+			return *this;
+		}
+
+		polymorphic_ring_iterator operator++(int) noexcept
+		{
+			return{ ring_, i_++ };
+		}
+
+		polymorphic_ring_iterator operator--(int) noexcept
+		{
+			return{ ring_, i_-- };
+		}
+
+		polymorphic_ring_iterator& operator+=(difference_type const n) noexcept
+		{
+			i_ += n;
+			return *this;
+		}
+
+		polymorphic_ring_iterator& operator-=(difference_type const n) noexcept
+		{
+			i_ -= n;
+			return *this;
+		}
+
+		friend polymorphic_ring_iterator operator+(
+			polymorphic_ring_iterator const& lhs, difference_type const n) noexcept
+		{
+			return{ lhs.ring_, lhs.i_ + n };
+		}
+
+		friend polymorphic_ring_iterator operator+(
+			difference_type const n, polymorphic_ring_iterator const& rhs) noexcept
+		{
+			return{ rhs.ring_, rhs.i_ + n };
+		}
+
+		friend polymorphic_ring_iterator operator-(
+			polymorphic_ring_iterator const& lhs, difference_type const n) noexcept
+		{
+			return{ lhs.ring_, lhs.i_ - n };
+		}
+
+		friend difference_type operator-(polymorphic_ring_iterator const& lhs,
+			polymorphic_ring_iterator const& rhs) noexcept
+		{
+			return difference_type(lhs.i_) - difference_type(rhs.i_);
+		}
+
+		friend bool operator==(polymorphic_ring_iterator const& lhs,
+			polymorphic_ring_iterator const& rhs) noexcept
+		{
+			return lhs.i_ == rhs.i_ && lhs.ring_ == rhs.ring_;
+		}
+
+		friend bool operator!=(polymorphic_ring_iterator const& lhs,
+			polymorphic_ring_iterator const& rhs) noexcept
+		{
+			return lhs.i_ != rhs.i_ || lhs.ring_ != rhs.ring_;
+		}
+
+		friend bool operator<(polymorphic_ring_iterator const& lhs,
+			polymorphic_ring_iterator const& rhs) noexcept
+		{
+			return lhs.i_ < rhs.i_;
+		}
+
+		friend bool operator<=(polymorphic_ring_iterator const& lhs,
+			polymorphic_ring_iterator const& rhs) noexcept
+		{
+			return lhs.i_ <= rhs.i_;
+		}
+
+		friend bool operator>(polymorphic_ring_iterator const& lhs,
+			polymorphic_ring_iterator const& rhs) noexcept
+		{
+			return lhs.i_ > rhs.i_;
+		}
+
+		friend bool operator>=(polymorphic_ring_iterator const& lhs,
+			polymorphic_ring_iterator const& rhs) noexcept
+		{
+			return lhs.i_ >= rhs.i_;
+		}
+
+	private:
+		friend class polymorphic_ring<B>;
+		template<class, bool> friend class polymorphic_ring_iterator;
+
+		using ring_pointer = std::conditional_t<is_const, polymorphic_ring<B> const*, polymorphic_ring<B>*>;
+
+		polymorphic_ring_iterator(ring_pointer ring, std::size_t const i) noexcept
+			: ring_{ ring }
+			, i_{ i }
+		{}
+
+		ring_pointer ring_;
+		std::size_t i_;
+	};
+
+	// FIFO container of any type derived from B, for queues of heterogeneous
+	// events. objects live in a circular byte arena: push_back() places behind
+	// the newest element and wraps to the start of the arena when the object
+	// does not fit before its end; pop_front() releases the oldest block. both
+	// are O(1) and move no other element.
+	//
+	// the handles form a ring of their own, so indexing is O(1) as well. when
+	// either ring is full it grows, and a growing arena is rewritten once from
+	// its start in FIFO order, which also undoes the wrap.
+	template<class B>
+	class polymorphic_ring
+	{
+	public:
+		using byte = gut::contiguous_allocator::byte;
+
+		using value_type = B;
+		using reference = value_type&;
+		using const_reference = value_type const&;
+		using pointer = value_type*;
+		using const_pointer = value_type const*;
+
+		using iterator = gut::polymorphic_ring_iterator<B, false>;
+		using const_iterator = gut::polymorphic_ring_iterator<B, true>;
+		using size_type = gut::contiguous_allocator::size_type;
+		using difference_type = typename iterator::difference_type;
+
+		// iterators
+		iterator begin() noexcept;
+		const_iterator begin() const noexcept;
+		iterator end() noexcept;
+		const_iterator end() const noexcept;
+
+		const_iterator cbegin() const noexcept;
+		const_iterator cend() const noexcept;
+
+		// destructor
+		~polymorphic_ring();
+
+		// constructors
+		explicit polymorphic_ring(size_type const capacity = 0,
+			gut::arena_backing const b = gut::arena_backing::heap());
+
+		polymorphic_ring(polymorphic_ring&& other) noexcept;
+		polymorphic_ring& operator=(polymorphic_ring&& other) noexcept;
+
+		polymorphic_ring(polymorphic_ring const& other);
+		polymorphic_ring& operator=(polymorphic_ring const& other);
+
+		// modifiers
+		template<class D, gut::enable_if_derived_t<B, D> = 0>
+		void push_back(D&& value);
+
+		template<class D, class... Args, gut::enable_if_derived_t<B, D> = 0>
+		void emplace_back(Args&&... args);
+
+		void pop_front();
+		void swap(polymorphic_ring& other) noexcept;
+		void clear();
+
+		// element access, from the oldest element on
+		reference operator[](size_type const i) noexcept;
+		const_reference operator[](size_type const i) const noexcept;
+
+		reference at(size_type const i);
+		const_reference at(size_type const i) const;
+
+		reference front() noexcept;
+		const_reference front() const noexcept;
+
+		reference back() noexcept;
+		const_reference back() const noexcept;
+
+		// capacity
+		size_type size() const noexcept;
+		bool empty() const noexcept;
+
+		// bytes in the arena
+		size_type capacity() const noexcept;
+
+	private:
+		gut::polymorphic_handle& handle(size_type const i) noexcept;
+		gut::polymorphic_handle const& handle(size_type const i) const noexcept;
+
+		// finds room for an object behind the newest element, wrapping to the
+		// start of the arena if needed; false if the free bytes are too few
+		bool place(size_type const align, size_type const size, byte*& blk, byte*& src) const noexcept;
+
+		// rewrites the elements from the start of a new arena of at least ncap
+		// bytes, leaving room for extra more bytes behind them
+		void grow(size_type const ncap, size_type const extra);
+		void grow_handles();
+
+		// an upper bound of the bytes needed to pack every element in order
+		size_type packed_bound() const;
+
+		void ensure_index_bounds(size_type const i) const;
+
+		byte* data_;
+		size_type cap_;
+
+		// the block of the oldest element starts at head_ and the next block at
+		// tail_; the elements are wrapped when tail_ < head_. an empty ring has
+		// both at 0
+		size_type head_;
+		size_type tail_;
+
+		// a power of two sized ring; the oldest handle is at first_
+		std::vector<gut::polymorphic_handle> handles_;
+		size_type first_;
+		size_type count_;
+
+		gut::arena_backing backing_;
+	};
+}
+//////////////////////////////////////////////////////////////////////////////////
+// iterators
+//////////////////////////////////////////////////////////////////////////////////
+template<class B>
+inline typename gut::polymorphic_ring<B>::iterator gut::polymorphic_ring<B>::begin() noexcept
+{
+	return{ this, 0 };
+}
+
+template<class B>
+inline typename gut::polymorphic_ring<B>::const_iterator gut::polymorphic_ring<B>::begin() const noexcept
+{
+	return{ this, 0 };
+}
+
+template<class B>
+inline typename gut::polymorphic_ring<B>::iterator gut::polymorphic_ring<B>::end() noexcept
+{
+	return{ this, count_ };
+}
+
+template<class B>
+inline typename gut::polymorphic_ring<B>::const_iterator gut::polymorphic_ring<B>::end() const noexcept
+{
+	return{ this, count_ };
+}
+
+template<class B>
+inline typename gut::polymorphic_ring<B>::const_iterator gut::polymorphic_ring<B>::cbegin() const noexcept
+{
+	return begin();
+}
+
+template<class B>
+inline typename gut::polymorphic_ring<B>::const_iterator gut::polymorphic_ring<B>::cend() const noexcept
+{
+	return end();
+}
+//////////////////////////////////////////////////////////////////////////////////
+// destructor
+//////////////////////////////////////////////////////////////////////////////////
+template<class B>
+inline gut::polymorphic_ring<B>::~polymorphic_ring()
+{
+	clear();
+	backing_.deallocate(data_, cap_);
+}
+//////////////////////////////////////////////////////////////////////////////////
+// constructors/assignment
+//////////////////////////////////////////////////////////////////////////////////
+template<class B>
+inline gut::polymorphic_ring<B>::polymorphic_ring(size_type const capacity,
+	gut::arena_backing const b)
+	: data_{ static_cast<byte*>(b.allocate(capacity)) }
+	, cap_{ 0 }
+	, head_{ 0 }
+	, tail_{ 0 }
+	, first_{ 0 }
+	, count_{ 0 }
+	, backing_(b)
+{
+	if (data_)
+	{
+		cap_ = capacity;
+	}
+	else
+	{
+		throw std::bad_alloc{};
+	}
+}
+
+template<class B>
+inline gut::polymorphic_ring<B>::polymorphic_ring(polymorphic_ring&& other) noexcept
+	: data_{ other.data_ }
+	, cap_{ other.cap_ }
+	, head_{ other.head_ }
+	, tail_{ other.tail_ }
+	, handles_{ std::move(other.handles_) }
+	, first_{ other.first_ }
+	, count_{ other.count_ }
+	, backing_(other.backing_)
+{
+	other.data_ = nullptr;
+	other.cap_ = 0;
+	other.head_ = 0;
+	other.tail_ = 0;
+	other.handles_.clear();
+	other.first_ = 0;
+	other.count_ = 0;
+}
+
+template<class B>
+inline gut::polymorphic_ring<B>& gut::polymorphic_ring<B>::operator=(polymorphic_ring&& other) noexcept
+{
+	if (this != &other)
+	{
+		polymorphic_ring tmp{ std::move(other) };
+		swap(tmp);
+	}
+	return *this;
+}
+
+template<class B>
+gut::polymorphic_ring<B>::polymorphic_ring(polymorphic_ring const& other)
+	: polymorphic_ring(other.packed_bound(), other.backing_)
+{
+	size_type hcap{ 16 };
+	while (hcap < other.count_)
+	{
+		hcap *= 2;
+	}
+	handles_.resize(hcap);
+
+	// the copy is packed from the start of its arena, unwrapped
+	for (size_type i{ 0 }; i != other.count_; ++i)
+	{
+		auto const& h = other.handle(i);
+		byte* blk{ data_ + tail_ };
+		byte* src{ make_aligned(blk, h->align()) };
+
+		h->copy(blk, src, handles_[i]);
+		++count_;
+		tail_ = src + h->size() - data_;
+	}
+}
+
+template<class B>
+inline gut::polymorphic_ring<B>& gut::polymorphic_ring<B>::operator=(polymorphic_ring const& other)
+{
+	if (this != &other)
+	{
+		polymorphic_ring tmp{ other };
+		swap(tmp);
+	}
+	return *this;
+}
+//////////////////////////////////////////////////////////////////////////////////
+// modifiers
+//////////////////////////////////////////////////////////////////////////////////
+template<class B>
+template<class D, gut::enable_if_derived_t<B, D>>
+inline void gut::polymorphic_ring<B>::push_back(D&& value)
+{
+	emplace_back<std::decay_t<D>>(std::forward<D>(value));
+}
+
+template<class B>
+template<class D, class... Args, gut::enable_if_derived_t<B, D>>
+inline void gut::polymorphic_ring<B>::emplace_back(Args&&... args)
+{
+	if (count_ == handles_.size())
+	{
+		grow_handles();
+	}
+
+	byte* blk;
+	byte* src;
+	if (!place(alignof(D), sizeof(D), blk, src))
+	{
+		grow(cap_ * 2, sizeof(D) + alignof(D) - 1);
+		place(alignof(D), sizeof(D), blk, src);
+	}
+
+	// nothing is committed until the object exists
+	D* p{ ::new (src) D{ std::forward<Args>(args)... } };
+
+	handles_[(first_ + count_) & (handles_.size() - 1)] =
+		gut::polymorphic_handle{ gut::handle<D>{ blk, p } };
+	++count_;
+	tail_ = src + sizeof(D) - data_;
+}
+
+template<class B>
+inline void gut::polymorphic_ring<B>::pop_front()
+{
+	assert(count_ != 0);
+
+	auto& h = handles_[first_];
+	h->destroy();
+	h = gut::polymorphic_handle{};
+
+	first_ = (first_ + 1) & (handles_.size() - 1);
+	--count_;
+
+	// the oldest block now is the next one; the bytes skipped by a wrap belong
+	// to the block that wrapped, so they are released along with it
+	if (count_ == 0)
+	{
+		head_ = 0;
+		tail_ = 0;
+		first_ = 0;
+	}
+	else
+	{
+		head_ = static_cast<byte*>(handles_[first_]->blk()) - data_;
+	}
+}
+
+template<class B>
+inline void gut::polymorphic_ring<B>::swap(polymorphic_ring& other) noexcept
+{
+	std::swap(data_, other.data_);
+	std::swap(cap_, other.cap_);
+	std::swap(head_, other.head_);
+	std::swap(tail_, other.tail_);
+	handles_.swap(other.handles_);
+	std::swap(first_, other.first_);
+	std::swap(count_, other.count_);
+	std::swap(backing_, other.backing_);
+}
+
+template<class B>
+inline void gut::polymorphic_ring<B>::clear()
+{
+	while (count_ != 0)
+	{
+		pop_front();
+	}
+}
+//////////////////////////////////////////////////////////////////////////////////
+// element access
+//////////////////////////////////////////////////////////////////////////////////
+template<class B>
+inline typename gut::polymorphic_ring<B>::reference
+gut::polymorphic_ring<B>::operator[](size_type const i) noexcept
+{
+	return *reinterpret_cast<pointer>(handle(i)->src());
+}
+
+template<class B>
+inline typename gut::polymorphic_ring<B>::const_reference
+gut::polymorphic_ring<B>::operator[](size_type const i) const noexcept
+{
+	return *reinterpret_cast<const_pointer>(handle(i)->src());
+}
+
+template<class B>
+inline typename gut::polymorphic_ring<B>::reference gut::polymorphic_ring<B>::at(size_type const i)
+{
+	ensure_index_bounds(i);
+	return (*this)[i];
+}
+
+template<class B>
+inline typename gut::polymorphic_ring<B>::const_reference gut::polymorphic_ring<B>::at(size_type const i) const
+{
+	ensure_index_bounds(i);
+	return (*this)[i];
+}
+
+template<class B>
+inline typename gut::polymorphic_ring<B>::reference gut::polymorphic_ring<B>::front() noexcept
+{
+	return (*this)[0];
+}
+
+template<class B>
+inline typename gut::polymorphic_ring<B>::const_reference gut::polymorphic_ring<B>::front() const noexcept
+{
+	return (*this)[0];
+}
+
+template<class B>
+inline typename gut::polymorphic_ring<B>::reference gut::polymorphic_ring<B>::back() noexcept
+{
+	return (*this)[count_ - 1];
+}
+
+template<class B>
+inline typename gut::polymorphic_ring<B>::const_reference gut::polymorphic_ring<B>::back() const noexcept
+{
+	return (*this)[count_ - 1];
+}
+//////////////////////////////////////////////////////////////////////////////////
+// capacity
+//////////////////////////////////////////////////////////////////////////////////
+template<class B>
+inline typename gut::polymorphic_ring<B>::size_type gut::polymorphic_ring<B>::size() const noexcept
+{
+	return count_;
+}
+
+template<class B>
+inline bool gut::polymorphic_ring<B>::empty() const noexcept
+{
+	return count_ == 0;
+}
+
+template<class B>
+inline typename gut::polymorphic_ring<B>::size_type gut::polymorphic_ring<B>::capacity() const noexcept
+{
+	return cap_;
+}
+///////////////////////////////////////////////////////////////////////////////
+// private member functions
+///////////////////////////////////////////////////////////////////////////////
+template<class B>
+inline gut::polymorphic_handle& gut::polymorphic_ring<B>::handle(size_type const i) noexcept
+{
+	assert(i < count_);
+	return handles_[(first_ + i) & (handles_.size() - 1)];
+}
+
+template<class B>
+inline gut::polymorphic_handle const& gut::polymorphic_ring<B>::handle(size_type const i) const noexcept
+{
+	assert(i < count_);
+	return handles_[(first_ + i) & (handles_.size() - 1)];
+}
+
+template<class B>
+inline bool gut::polymorphic_ring<B>::place(size_type const align, size_type const size,
+	byte*& blk, byte*& src) const noexcept
+{
+	blk = data_ + tail_;
+	src = make_aligned(blk, align);
+
+	// while wrapped, the free bytes lie between tail_ and head_. an object
+	// must end short of head_ so that tail_ == head_ only means empty
+	if (tail_ < head_)
+	{
+		return src + size < data_ + head_;
+	}
+
+	if (src + size <= data_ + cap_)
+	{
+		return true;
+	}
+
+	// wrap; the block keeps the bytes up to the end of the arena
+	src = make_aligned(data_, align);
+	return count_ != 0 && src + size < data_ + head_;
+}
+
+template<class B>
+void gut::polymorphic_ring<B>::grow(size_type const ncap, size_type const extra)
+{
+	size_type const cap{ std::max(ncap, packed_bound() + extra) };
+	byte* ndata{ static_cast<byte*>(backing_.allocate(cap)) };
+
+	if (!ndata)
+	{
+		throw std::bad_alloc{};
+	}
+
+	size_type offset{ 0 };
+	for (size_type i{ 0 }; i != count_; ++i)
+	{
+		auto& h = handle(i);
+		byte* blk{ ndata + offset };
+		byte* src{ make_aligned(blk, h->align()) };
+
+		if (h->is_trivially_relocatable())
+		{
+			std::memcpy(src, h->src(), h->size());
+			h->rebind(blk, src);
+		}
+		else
+		{
+			h->transfer(blk, src);
+		}
+		offset = src + h->size() - ndata;
+	}
+
+	backing_.deallocate(data_, cap_);
+	data_ = ndata;
+	cap_ = cap;
+	head_ = 0;
+	tail_ = offset;
+}
+
+template<class B>
+void gut::polymorphic_ring<B>::grow_handles()
+{
+	std::vector<gut::polymorphic_handle> handles(std::max(handles_.size() * 2, size_type{ 16 }));
+	for (size_type i{ 0 }; i != count_; ++i)
+	{
+		handles[i] = std::move(handle(i));
+	}
+	handles_.swap(handles);
+	first_ = 0;
+}
+
+template<class B>
+inline typename gut::polymorphic_ring<B>::size_type gut::polymorphic_ring<B>::packed_bound() const
+{
+	size_type bound{ 0 };
+	for (size_type i{ 0 }; i != count_; ++i)
+	{
+		auto const& h = handle(i);
+		bound += h->size() + h->align() - 1;
+	}
+	return bound;
+}
+
+template<class B>
+inline void gut::polymorphic_ring<B>::ensure_index_bounds(size_type const i) const
+{
+	if (i >= count_)
+	{
+		throw std::out_of_range
+		{
+			"polymorphic_ring<B>::ensure_index_bounds( size_type const i );\n"
+			"index out of range"
+		};
+	}
+}
+#endif // GUT_POLYMORPHIC_RING_H
@@ -1,5 +1,13 @@
+#ifndef GUT_POLYMORPHIC_VECTOR_H
+#define GUT_POLYMORPHIC_VECTOR_H
+
 #include "contiguous_allocator.h"
+#include "interface_view.h"
 #include "polymorphic_vector_iterator.h"
+#include "type_filter_iterator.h"
+#include <algorithm>
+#include <cstdint>
+#include <functional>
 #include <new>
 #include <utility>
 
@@ -14,8 +22,20 @@ namespace gut
 
 namespace gut
 {
+	template<class B> class polymorphic_vector_builder;
+	template<class B> class polymorphic_vector_serializer;
+	template<class B, class Projection> class projected_polymorphic_vector;
+	template<class B, class Projection, class Hash, class KeyEqual> class indexed_polymorphic_vector;
+	template<class B> class transform_plan;
+
+	// polymorphic_vector<B> stores any type derived from B; the closed
+	// hierarchy specializations polymorphic_vector<B, Ds...> and
+	// polymorphic_vector<B, gut::fixed_stride<Ds...>> are defined in
+	// closed_polymorphic_vector.h and fixed_stride_polymorphic_vector.h
+	template<class B, class... Ds> class polymorphic_vector;
+
 	template<class B>
-	class polymorphic_vector
+	class polymorphic_vector<B>
 	{
 	public:
 		using byte = gut::contiguous_allocator::byte;
@@ -54,7 +74,9 @@ namespace gut
 		~polymorphic_vector();
 
 		// constructors
-		polymorphic_vector(size_type const capacity = 0);
+		polymorphic_vector(size_type const capacity = 0,
+			gut::placement const p = gut::placement::packed(),
+			gut::arena_backing const b = gut::arena_backing::heap());
 
 		polymorphic_vector(polymorphic_vector&&) = default;
 		polymorphic_vector& operator=(polymorphic_vector&&) = default;
@@ -71,6 +93,42 @@ namespace gut
 
 		iterator erase(const_iterator position);
 		iterator erase(const_iterator begin, const_iterator end);
+
+		// destroys the element at position and constructs a D with the same
+		// index in its place. D takes the old block when it fits there, with its
+		// padding and the gaps around it; otherwise it is built behind the last
+		// element and the old block is left as a gap, so no other element moves
+		// either way. as with emplace_back, args must not refer into the
+		// element being replaced. if the constructor of D throws, the element
+		// is gone: position is erased
+		template<class D, class... Args, gut::enable_if_derived_t<B, D> = 0>
+		D& replace(const_iterator position, Args&&... args);
+
+		void splice(const_iterator position, polymorphic_vector&& other);
+		void append(polymorphic_vector&& other);
+
+		// reorder the elements by permuting their handles only; the objects stay
+		// where they are until compact_in_order() or the next growth
+		template<class Compare = std::less<>>
+		void sort(Compare comp = Compare{});
+
+		template<class Compare = std::less<>>
+		void stable_sort(Compare comp = Compare{});
+
+		void compact_in_order();
+
+		// rewrites the arena with the given placement and returns the number of
+		// bytes reclaimed
+		size_type compact(gut::packing const p = gut::packing::in_order);
+
+		// with gut::compaction::incremental, erase leaves its gap in place and
+		// compact_step() closes gaps about byte_budget bytes at a time, until it
+		// returns 0; the vector stays fully usable in between
+		void set_compaction(gut::compaction const c) noexcept;
+		size_type compact_step(size_type const byte_budget);
+
+		// how the arena and the handle table grow, geometric() by default
+		void set_growth(gut::growth const g) noexcept;
 		
 		void pop_back();
 		void swap(polymorphic_vector& other) noexcept;
@@ -89,13 +147,59 @@ namespace gut
 		reference back() noexcept;
 		const_reference back() const noexcept;
 
-		// capacity - maybe add reserve() <---- think about this one more
+		// type queries, answered from the handles without touching the objects
+		// or going through dynamic_cast; D matches only the exact type an
+		// element was inserted as, not its bases
+		template<class D, gut::enable_if_derived_t<B, D> = 0>
+		bool holds(size_type const i) const noexcept;
+
+		template<class D, gut::enable_if_derived_t<B, D> = 0>
+		D* get_if(size_type const i) noexcept;
+
+		template<class D, gut::enable_if_derived_t<B, D> = 0>
+		D const* get_if(size_type const i) const noexcept;
+
+		template<class D, gut::enable_if_derived_t<B, D> = 0>
+		size_type count_of() const noexcept;
+
+		template<class D, gut::enable_if_derived_t<B, D> = 0>
+		gut::type_filter_range<D, false> of_type() noexcept;
+
+		template<class D, gut::enable_if_derived_t<B, D> = 0>
+		gut::type_filter_range<D, true> of_type() const noexcept;
+
+		// the elements implementing the interface I, as I&, skipping the others;
+		// the cross-cast is looked up once per concrete type, not per element
+		template<class I>
+		gut::interface_view<I, false> view();
+
+		template<class I>
+		gut::interface_view<I, true> view() const;
+
+		// capacity
 		size_type size() const noexcept;
 		bool empty() const noexcept;
 
+		// room for an arena of bytes and a handle table of count elements, so
+		// that filling the vector up to them allocates nothing
+		void reserve(size_type const bytes, size_type const count);
+
+		// instrumentation
+		gut::arena_stats stats() const;
+		size_type footprint() const noexcept;
+
 	private:
+		friend class gut::polymorphic_vector_builder<B>;
+		friend class gut::polymorphic_vector_serializer<B>;
+		template<class, class> friend class gut::projected_polymorphic_vector;
+		template<class, class, class, class> friend class gut::indexed_polymorphic_vector;
+		template<class> friend class gut::transform_plan;
+
 		void ensure_index_bounds(size_type const i) const;
 
+		template<class I>
+		static I const* cross_cast(void const* src);
+
 		gut::contiguous_allocator alloc_;
 	};
 }
@@ -191,17 +295,15 @@ gut::polymorphic_vector<B>::crend() const noexcept
 template<class B>
 inline gut::polymorphic_vector<B>::~polymorphic_vector()
 {
-	for (auto& h : alloc_.handles_)
-	{
-		h->destroy();
-	}
+	alloc_.destroy_elements(0, alloc_.handles_.size());
 }
 //////////////////////////////////////////////////////////////////////////////////
 // constructors/assignment
 //////////////////////////////////////////////////////////////////////////////////
 template<class B>
-inline gut::polymorphic_vector<B>::polymorphic_vector(size_type const capacity)
-	: alloc_{ capacity }
+inline gut::polymorphic_vector<B>::polymorphic_vector(size_type const capacity,
+	gut::placement const p, gut::arena_backing const b)
+	: alloc_{ capacity, p, b }
 {}
 //////////////////////////////////////////////////////////////////////////////////
 // modifiers
@@ -236,13 +338,98 @@ gut::polymorphic_vector<B>::erase(const_iterator begin, const_iterator end)
 	return{ alloc_.handles_ , begin.iter_idx_ };
 }
 
+template<class B>
+template<class D, class... Args, gut::enable_if_derived_t<B, D>>
+inline D& gut::polymorphic_vector<B>::replace(const_iterator position, Args&&... args)
+{
+	size_type const i{ position.iter_idx_ };
+	D* p{ alloc_.replace<D>(i) };
+
+	try
+	{
+		return *::new (p) D{ std::forward<Args>(args)... };
+	}
+	catch (...)
+	{
+		alloc_.abandon(i);
+		throw;
+	}
+}
+
+template<class B>
+inline void gut::polymorphic_vector<B>::splice(const_iterator position, polymorphic_vector&& other)
+{
+	alloc_.splice(position.iter_idx_, std::move(other.alloc_));
+}
+
+template<class B>
+inline void gut::polymorphic_vector<B>::append(polymorphic_vector&& other)
+{
+	alloc_.splice(alloc_.handles_.size(), std::move(other.alloc_));
+}
+
+template<class B>
+template<class Compare>
+inline void gut::polymorphic_vector<B>::sort(Compare comp)
+{
+	std::sort(alloc_.handles_.begin(), alloc_.handles_.end(),
+		[&comp](gut::polymorphic_handle const& x, gut::polymorphic_handle const& y)
+	{
+		return comp(*reinterpret_cast<const_pointer>(x->src()),
+			*reinterpret_cast<const_pointer>(y->src()));
+	});
+	alloc_.reordered();
+}
+
+template<class B>
+template<class Compare>
+inline void gut::polymorphic_vector<B>::stable_sort(Compare comp)
+{
+	std::stable_sort(alloc_.handles_.begin(), alloc_.handles_.end(),
+		[&comp](gut::polymorphic_handle const& x, gut::polymorphic_handle const& y)
+	{
+		return comp(*reinterpret_cast<const_pointer>(x->src()),
+			*reinterpret_cast<const_pointer>(y->src()));
+	});
+	alloc_.reordered();
+}
+
+template<class B>
+inline void gut::polymorphic_vector<B>::compact_in_order()
+{
+	alloc_.compact_in_order();
+}
+
+template<class B>
+inline typename gut::polymorphic_vector<B>::size_type
+gut::polymorphic_vector<B>::compact(gut::packing const p)
+{
+	return alloc_.compact(p);
+}
+
+template<class B>
+inline void gut::polymorphic_vector<B>::set_compaction(gut::compaction const c) noexcept
+{
+	alloc_.set_compaction(c);
+}
+
+template<class B>
+inline typename gut::polymorphic_vector<B>::size_type
+gut::polymorphic_vector<B>::compact_step(size_type const byte_budget)
+{
+	return alloc_.compact_step(byte_budget);
+}
+
+template<class B>
+inline void gut::polymorphic_vector<B>::set_growth(gut::growth const g) noexcept
+{
+	alloc_.set_growth(g);
+}
+
 template<class B>
 inline void gut::polymorphic_vector<B>::pop_back()
 {
-	gut::polymorphic_handle& h{ alloc_.handles_.back() };
-	alloc_.offset_ = reinterpret_cast<byte*>(h->blk()) - alloc_.data_;
-	h->destroy();
-	alloc_.handles_.pop_back();
+	alloc_.deallocate_back();
 }
 
 template<class B>
@@ -317,6 +504,78 @@ gut::polymorphic_vector<B>::back() const noexcept
 	return *reinterpret_cast<const_pointer>(alloc_.handles_[alloc_.handles_.size() - 1]->src());
 }
 //////////////////////////////////////////////////////////////////////////////////
+// type queries
+//////////////////////////////////////////////////////////////////////////////////
+template<class B>
+template<class D, gut::enable_if_derived_t<B, D>>
+inline bool gut::polymorphic_vector<B>::holds(size_type const i) const noexcept
+{
+	return alloc_.handles_[i].template holds<D>();
+}
+
+template<class B>
+template<class D, gut::enable_if_derived_t<B, D>>
+inline D* gut::polymorphic_vector<B>::get_if(size_type const i) noexcept
+{
+	auto& h = alloc_.handles_[i];
+	return h.template holds<D>() ? reinterpret_cast<D*>(h->src()) : nullptr;
+}
+
+template<class B>
+template<class D, gut::enable_if_derived_t<B, D>>
+inline D const* gut::polymorphic_vector<B>::get_if(size_type const i) const noexcept
+{
+	auto const& h = alloc_.handles_[i];
+	return h.template holds<D>() ? reinterpret_cast<D const*>(h->src()) : nullptr;
+}
+
+template<class B>
+template<class D, gut::enable_if_derived_t<B, D>>
+inline typename gut::polymorphic_vector<B>::size_type
+gut::polymorphic_vector<B>::count_of() const noexcept
+{
+	std::uint32_t const type{ gut::find_type_index_of<D>() };
+
+	size_type n{ 0 };
+	for (auto const& h : alloc_.handles_)
+	{
+		n += h.type_index() == type;
+	}
+	return n;
+}
+
+template<class B>
+template<class D, gut::enable_if_derived_t<B, D>>
+inline gut::type_filter_range<D, false> gut::polymorphic_vector<B>::of_type() noexcept
+{
+	auto const first = alloc_.handles_.data();
+	return{ first, first + alloc_.handles_.size() };
+}
+
+template<class B>
+template<class D, gut::enable_if_derived_t<B, D>>
+inline gut::type_filter_range<D, true> gut::polymorphic_vector<B>::of_type() const noexcept
+{
+	auto const first = alloc_.handles_.data();
+	return{ first, first + alloc_.handles_.size() };
+}
+
+template<class B>
+template<class I>
+inline gut::interface_view<I, false> gut::polymorphic_vector<B>::view()
+{
+	auto const first = alloc_.handles_.data();
+	return{ first, first + alloc_.handles_.size(), &cross_cast<I> };
+}
+
+template<class B>
+template<class I>
+inline gut::interface_view<I, true> gut::polymorphic_vector<B>::view() const
+{
+	auto const first = alloc_.handles_.data();
+	return{ first, first + alloc_.handles_.size(), &cross_cast<I> };
+}
+//////////////////////////////////////////////////////////////////////////////////
 // capacity
 //////////////////////////////////////////////////////////////////////////////////
 template<class B>
@@ -331,6 +590,27 @@ inline bool gut::polymorphic_vector<B>::empty() const noexcept
 {
 	return alloc_.handles_.empty();
 }
+
+template<class B>
+inline void gut::polymorphic_vector<B>::reserve(size_type const bytes, size_type const count)
+{
+	alloc_.reserve(bytes, count);
+}
+//////////////////////////////////////////////////////////////////////////////////
+// instrumentation
+//////////////////////////////////////////////////////////////////////////////////
+template<class B>
+inline gut::arena_stats gut::polymorphic_vector<B>::stats() const
+{
+	return alloc_.stats();
+}
+
+template<class B>
+inline typename gut::polymorphic_vector<B>::size_type
+gut::polymorphic_vector<B>::footprint() const noexcept
+{
+	return alloc_.footprint();
+}
 ///////////////////////////////////////////////////////////////////////////////
 // private member functions
 ///////////////////////////////////////////////////////////////////////////////
@@ -346,6 +626,14 @@ inline void gut::polymorphic_vector<B>::ensure_index_bounds(size_type const i) c
 		};
 	}
 }
+
+template<class B>
+template<class I>
+inline I const* gut::polymorphic_vector<B>::cross_cast(void const* src)
+{
+	static_assert(std::is_polymorphic<B>::value, "view<I>() cross-casts from B, which must be polymorphic");
+	return dynamic_cast<I const*>(reinterpret_cast<const_pointer>(src));
+}
 ///////////////////////////////////////////////////////////////////////////////
 // specialized algorithms
 ///////////////////////////////////////////////////////////////////////////////
@@ -354,4 +642,25 @@ void swap(gut::polymorphic_vector<B>& x, gut::polymorphic_vector<B>& y)
 noexcept(noexcept(x.swap(y)))
 {
 	x.swap(y);
-}
\ No newline at end of file
+}
+
+namespace gut
+{
+	// std::sort cannot be used on polymorphic_vector iterators: assigning
+	// through B& would slice the elements
+	template<class B, class Compare = std::less<>>
+	void sort(gut::polymorphic_vector<B>& pv, Compare comp = Compare{})
+	{
+		pv.sort(comp);
+	}
+
+	template<class B, class Compare = std::less<>>
+	void stable_sort(gut::polymorphic_vector<B>& pv, Compare comp = Compare{})
+	{
+		pv.stable_sort(comp);
+	}
+}
+
+#include "closed_polymorphic_vector.h"
+#include "fixed_stride_polymorphic_vector.h"
+#endif // GUT_POLYMORPHIC_VECTOR_H
\ No newline at end of file
@@ -0,0 +1,269 @@
+#ifndef GUT_POLYMORPHIC_VECTOR_BUILDER_H
+#define GUT_POLYMORPHIC_VECTOR_BUILDER_H
+
+#include "polymorphic_vector.h"
+#include <algorithm>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace gut
+{
+	// collects elements from several producer threads without contention and
+	// seals them into a single contiguous polymorphic_vector<B>.
+	//
+	// every producer emplaces into its own shard (shard(i) for worker i); shards
+	// share nothing, so no synchronization is needed until seal(). seal() must
+	// not run concurrently with any producer. it measures every shard, presizes
+	// one arena, and relocates the shards into it in parallel, keeping shard
+	// order. element relocation is expected not to throw; an exception thrown
+	// by a move/copy constructor during seal() terminates the program.
+	template<class B>
+	class polymorphic_vector_builder
+	{
+	public:
+		using byte = gut::contiguous_allocator::byte;
+		using size_type = gut::contiguous_allocator::size_type;
+		using shard_type = gut::polymorphic_vector<B>;
+
+		~polymorphic_vector_builder() = default;
+
+		explicit polymorphic_vector_builder(size_type const shard_count,
+			size_type const shard_capacity = 0);
+
+		polymorphic_vector_builder(polymorphic_vector_builder&&) = default;
+		polymorphic_vector_builder& operator=(polymorphic_vector_builder&&) = default;
+
+		polymorphic_vector_builder(polymorphic_vector_builder const&) = delete;
+		polymorphic_vector_builder& operator=(polymorphic_vector_builder const&) = delete;
+
+		shard_type& shard(size_type const i) noexcept;
+		size_type shard_count() const noexcept;
+		size_type size() const noexcept;
+
+		// moves every element into one contiguous arena and empties the shards;
+		// shard arenas keep their capacity for the next round. with a mapped
+		// backing no page of the arena is touched before the workers relocate
+		// into it, so under numa_policy::first_touch every worker's range ends up
+		// on the node it runs on.
+		gut::polymorphic_vector<B> seal(size_type thread_count = std::thread::hardware_concurrency(),
+			gut::arena_backing const backing = gut::arena_backing::heap());
+
+	private:
+		// padded so that the bookkeeping of neighbouring shards, which is written
+		// on every emplace, never shares a cache line
+		struct padded_shard
+		{
+			padded_shard(size_type const capacity)
+				: elements{ capacity }
+			{}
+
+			shard_type elements;
+			char padding[gut::destructive_interference_size];
+		};
+
+		struct shard_layout
+		{
+			size_type align;
+			size_type size;
+			byte* block;
+			byte* start;
+		};
+
+		template<class F>
+		void for_each_shard(size_type const thread_count, F&& f);
+
+		static void measure(shard_type const& s, shard_layout& layout) noexcept;
+		static void relocate(shard_type& s, shard_layout const& layout,
+			gut::polymorphic_handle* out) noexcept;
+
+		std::vector<padded_shard> shards_;
+	};
+}
+//////////////////////////////////////////////////////////////////////////////////
+// constructors
+//////////////////////////////////////////////////////////////////////////////////
+template<class B>
+inline gut::polymorphic_vector_builder<B>::polymorphic_vector_builder(
+	size_type const shard_count, size_type const shard_capacity)
+{
+	shards_.reserve(shard_count);
+	for (size_type i{ 0 }; i != shard_count; ++i)
+	{
+		shards_.emplace_back(shard_capacity);
+	}
+}
+//////////////////////////////////////////////////////////////////////////////////
+// member access
+//////////////////////////////////////////////////////////////////////////////////
+template<class B>
+inline typename gut::polymorphic_vector_builder<B>::shard_type&
+gut::polymorphic_vector_builder<B>::shard(size_type const i) noexcept
+{
+	return shards_[i].elements;
+}
+
+template<class B>
+inline typename gut::polymorphic_vector_builder<B>::size_type
+gut::polymorphic_vector_builder<B>::shard_count() const noexcept
+{
+	return shards_.size();
+}
+
+template<class B>
+inline typename gut::polymorphic_vector_builder<B>::size_type
+gut::polymorphic_vector_builder<B>::size() const noexcept
+{
+	size_type n{ 0 };
+	for (auto const& s : shards_)
+	{
+		n += s.elements.size();
+	}
+	return n;
+}
+//////////////////////////////////////////////////////////////////////////////////
+// seal
+//////////////////////////////////////////////////////////////////////////////////
+template<class B>
+gut::polymorphic_vector<B> gut::polymorphic_vector_builder<B>::seal(size_type thread_count,
+	gut::arena_backing const backing)
+{
+	std::vector<shard_layout> layouts(shards_.size());
+
+	for_each_shard(thread_count, [&](size_type const i)
+	{
+		measure(shards_[i].elements, layouts[i]);
+	});
+
+	// each shard starts on its own strictest alignment, so its relative layout
+	// is independent of where it lands; reserve the worst case rounding slack
+	size_type cap{ 0 };
+	size_type count{ 0 };
+	for (auto const& l : layouts)
+	{
+		cap += l.size + l.align - 1;
+	}
+	for (auto const& s : shards_)
+	{
+		count += s.elements.size();
+	}
+
+	gut::polymorphic_vector<B> result{ cap, gut::placement::packed(), backing };
+	auto& alloc = result.alloc_;
+
+	byte* blk{ alloc.data_ };
+	for (auto& l : layouts)
+	{
+		l.block = blk;
+		l.start = make_aligned(blk, l.align);
+		blk = l.start + l.size;
+	}
+
+	alloc.handles_.resize(count);
+
+	std::vector<size_type> first(shards_.size());
+	for (size_type i{ 0 }, n{ 0 }; i != shards_.size(); ++i)
+	{
+		first[i] = n;
+		n += shards_[i].elements.size();
+	}
+
+	for_each_shard(thread_count, [&](size_type const i)
+	{
+		relocate(shards_[i].elements, layouts[i], alloc.handles_.data() + first[i]);
+	});
+
+	alloc.offset_ = blk - alloc.data_;
+	return result;
+}
+//////////////////////////////////////////////////////////////////////////////////
+// private member functions
+//////////////////////////////////////////////////////////////////////////////////
+template<class B>
+template<class F>
+void gut::polymorphic_vector_builder<B>::for_each_shard(size_type const thread_count, F&& f)
+{
+	size_type const n{ shards_.size() };
+	size_type const workers{ std::min(std::max(thread_count, size_type{ 1 }), n) };
+
+	if (workers <= 1)
+	{
+		for (size_type i{ 0 }; i != n; ++i)
+		{
+			f(i);
+		}
+		return;
+	}
+
+	std::vector<std::thread> threads;
+	threads.reserve(workers - 1);
+
+	// worker w handles one contiguous run of shards, so the part of the
+	// sealed arena it relocates into is contiguous as well
+	auto run = [&f, workers, n](size_type const w)
+	{
+		for (size_type i{ w * n / workers }, last{ (w + 1) * n / workers }; i != last; ++i)
+		{
+			f(i);
+		}
+	};
+
+	for (size_type w{ 1 }; w != workers; ++w)
+	{
+		threads.emplace_back(run, w);
+	}
+
+	run(0);
+
+	for (auto& t : threads)
+	{
+		t.join();
+	}
+}
+
+template<class B>
+void gut::polymorphic_vector_builder<B>::measure(shard_type const& s, shard_layout& layout) noexcept
+{
+	size_type align{ 1 };
+	size_type offset{ 0 };
+
+	for (auto const& h : s.alloc_.handles_)
+	{
+		size_type const a{ h->align() };
+		offset = (offset + a - 1) & ~(a - 1);
+		offset += h->size();
+		align = std::max(align, a);
+	}
+
+	layout.align = align;
+	layout.size = offset;
+	layout.block = nullptr;
+	layout.start = nullptr;
+}
+
+template<class B>
+void gut::polymorphic_vector_builder<B>::relocate(shard_type& s, shard_layout const& layout,
+	gut::polymorphic_handle* out) noexcept
+{
+	auto& alloc = s.alloc_;
+
+	// the first block also owns the rounding slack in front of the shard
+	byte* blk{ layout.block };
+	byte* end{ layout.start };
+	byte* src;
+
+	for (auto& h : alloc.handles_)
+	{
+		src = make_aligned(end, h->align());
+
+		h->transfer(blk, src);
+		end = src + h->size();
+		blk = end;
+		*out++ = std::move(h);
+	}
+
+	alloc.handles_.clear();
+	alloc.sections_.clear();
+	alloc.offset_ = 0;
+}
+#endif // GUT_POLYMORPHIC_VECTOR_BUILDER_H
\ No newline at end of file
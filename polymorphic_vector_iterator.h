@@ -8,7 +8,7 @@
 
 namespace gut
 {
-	template<class> class polymorphic_vector;
+	template<class B, class... Ds> class polymorphic_vector;
 
 	template<class B, bool is_const>
 	class polymorphic_vector_iterator final
@@ -0,0 +1,349 @@
+#ifndef GUT_POLYMORPHIC_VECTOR_SERIALIZER_H
+#define GUT_POLYMORPHIC_VECTOR_SERIALIZER_H
+
+#include "mapped_file.h"
+#include "polymorphic_vector.h"
+#include "type_registry.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <typeinfo>
+#include <unordered_map>
+#include <vector>
+
+namespace gut
+{
+	// binary persistence of a polymorphic_vector<B>.
+	//
+	// the file holds a header, the table of distinct type ids, one compact type
+	// index and one arena offset per element, the packed arena image and the
+	// blob written by the save hooks of non-image types. load() maps the file
+	// and rebuilds every element and handle in a single pass over the tables,
+	// so startup cost is one copy of the arena rather than a full re-emplace.
+	//
+	// files are meant to be read back by the same binary: the layout is native
+	// endian and uses the sizes and alignments of the writing process.
+	template<class B>
+	class polymorphic_vector_serializer
+	{
+	public:
+		using byte = gut::contiguous_allocator::byte;
+		using size_type = gut::contiguous_allocator::size_type;
+		using registry_type = gut::type_registry<B>;
+
+		static void save(gut::polymorphic_vector<B> const& pv, char const* path,
+			registry_type const& registry);
+
+		static gut::polymorphic_vector<B> load(char const* path,
+			registry_type const& registry);
+
+	private:
+		using entry = typename registry_type::entry;
+		using type_index_t = std::uint16_t;
+
+		struct header
+		{
+			char magic[8];
+			std::uint32_t version;
+			std::uint32_t type_count;
+			std::uint64_t count;
+			std::uint64_t arena_size;
+			std::uint64_t arena_align;
+			std::uint64_t blob_size;
+		};
+
+		struct layout
+		{
+			size_type types;
+			size_type indices;
+			size_type offsets;
+			size_type arena;
+			size_type blob;
+			size_type end;
+		};
+
+		static constexpr char magic_[8] = { 'G', 'U', 'T', 'P', 'V', 'E', 'C', '\0' };
+		static constexpr std::uint32_t version_{ 1 };
+
+		static layout make_layout(header const& h) noexcept;
+		static size_type align_up(size_type const n, size_type const align) noexcept;
+
+		static void write_padding(std::ofstream& out, size_type from, size_type const to);
+
+		[[noreturn]] static void throw_corrupt(char const* what);
+	};
+}
+//////////////////////////////////////////////////////////////////////////////////
+// static data
+//////////////////////////////////////////////////////////////////////////////////
+template<class B>
+constexpr char gut::polymorphic_vector_serializer<B>::magic_[8];
+
+template<class B>
+constexpr std::uint32_t gut::polymorphic_vector_serializer<B>::version_;
+//////////////////////////////////////////////////////////////////////////////////
+// save
+//////////////////////////////////////////////////////////////////////////////////
+template<class B>
+void gut::polymorphic_vector_serializer<B>::save(gut::polymorphic_vector<B> const& pv,
+	char const* path, registry_type const& registry)
+{
+	auto const& handles = pv.alloc_.handles_;
+
+	std::vector<std::uint32_t> type_ids;
+	std::vector<entry const*> type_entries;
+	std::vector<type_index_t> indices;
+	std::vector<std::uint64_t> offsets;
+	std::vector<byte> blob;
+
+	indices.reserve(handles.size());
+	offsets.reserve(handles.size());
+
+	// elements of the same type usually come in runs, so remember the last one
+	// before falling back to the hash lookup
+	std::unordered_map<std::uint32_t, type_index_t> local;
+	std::type_info const* last_type{ nullptr };
+	type_index_t last_index{ 0 };
+
+	size_type offset{ 0 };
+	size_type arena_align{ 1 };
+
+	for (auto const& h : handles)
+	{
+		std::type_info const& type{ h->type() };
+		if (!last_type || *last_type != type)
+		{
+			entry const& e{ registry.find(type) };
+			auto it = local.find(e.id);
+			if (it == local.end())
+			{
+				if (type_entries.size() > type_index_t(~type_index_t{ 0 }))
+				{
+					throw std::length_error
+					{
+						"polymorphic_vector_serializer<B>::save( ... );\n"
+						"too many distinct types"
+					};
+				}
+				it = local.emplace(e.id, static_cast<type_index_t>(type_entries.size())).first;
+				type_ids.push_back(e.id);
+				type_entries.push_back(&e);
+			}
+			last_type = &type;
+			last_index = it->second;
+		}
+
+		entry const& e{ *type_entries[last_index] };
+		offset = align_up(offset, e.align);
+		arena_align = std::max(arena_align, e.align);
+
+		indices.push_back(last_index);
+		offsets.push_back(offset);
+		offset += e.size;
+
+		if (e.save)
+		{
+			e.save(*reinterpret_cast<B const*>(h->src()), blob);
+		}
+	}
+
+	header h{};
+	std::memcpy(h.magic, magic_, sizeof(magic_));
+	h.version = version_;
+	h.type_count = static_cast<std::uint32_t>(type_ids.size());
+	h.count = handles.size();
+	h.arena_size = offset;
+	h.arena_align = arena_align;
+	h.blob_size = blob.size();
+
+	layout const l{ make_layout(h) };
+
+	std::ofstream out{ path, std::ios::binary | std::ios::trunc };
+	if (!out)
+	{
+		throw std::runtime_error
+		{
+			std::string{ "polymorphic_vector_serializer<B>::save( ... );\n" } +
+			"unable to write " + path
+		};
+	}
+
+	out.write(reinterpret_cast<char const*>(&h), sizeof(h));
+	out.write(reinterpret_cast<char const*>(type_ids.data()), type_ids.size() * sizeof(std::uint32_t));
+	out.write(reinterpret_cast<char const*>(indices.data()), indices.size() * sizeof(type_index_t));
+	write_padding(out, l.indices + indices.size() * sizeof(type_index_t), l.offsets);
+	out.write(reinterpret_cast<char const*>(offsets.data()), offsets.size() * sizeof(std::uint64_t));
+	write_padding(out, l.offsets + offsets.size() * sizeof(std::uint64_t), l.arena);
+
+	// the image is packed from an arena_align boundary, so it is independent of
+	// where the source arena happened to be allocated
+	size_type written{ 0 };
+	for (size_type i{ 0 }; i != handles.size(); ++i)
+	{
+		entry const& e{ *type_entries[indices[i]] };
+		write_padding(out, written, offsets[i]);
+
+		if (e.revive)
+		{
+			out.write(reinterpret_cast<char const*>(handles[i]->src()), e.size);
+		}
+		else
+		{
+			write_padding(out, 0, e.size);
+		}
+		written = offsets[i] + e.size;
+	}
+
+	out.write(reinterpret_cast<char const*>(blob.data()), blob.size());
+
+	if (!out)
+	{
+		throw std::runtime_error
+		{
+			std::string{ "polymorphic_vector_serializer<B>::save( ... );\n" } +
+			"unable to write " + path
+		};
+	}
+}
+//////////////////////////////////////////////////////////////////////////////////
+// load
+//////////////////////////////////////////////////////////////////////////////////
+template<class B>
+gut::polymorphic_vector<B> gut::polymorphic_vector_serializer<B>::load(char const* path,
+	registry_type const& registry)
+{
+	gut::mapped_file file{ path };
+	byte const* data{ file.data() };
+
+	header h;
+	if (file.size() < sizeof(h))
+	{
+		throw_corrupt("truncated header");
+	}
+	std::memcpy(&h, data, sizeof(h));
+
+	if (std::memcmp(h.magic, magic_, sizeof(magic_)) != 0 || h.version != version_)
+	{
+		throw_corrupt("unknown format");
+	}
+	if (h.arena_align == 0 || (h.arena_align & (h.arena_align - 1)) != 0)
+	{
+		throw_corrupt("invalid alignment");
+	}
+
+	layout const l{ make_layout(h) };
+	if (file.size() < l.end)
+	{
+		throw_corrupt("truncated file");
+	}
+
+	// resolve the file's type table once; elements then index it directly
+	std::vector<entry const*> types(h.type_count);
+	for (size_type i{ 0 }; i != h.type_count; ++i)
+	{
+		std::uint32_t id;
+		std::memcpy(&id, data + l.types + i * sizeof(id), sizeof(id));
+		types[i] = &registry.find(id);
+	}
+
+	auto indices = reinterpret_cast<type_index_t const*>(data + l.indices);
+	auto offsets = reinterpret_cast<std::uint64_t const*>(data + l.offsets);
+	byte const* image{ data + l.arena };
+	byte const* blob{ data + l.blob };
+	byte const* blob_end{ blob + h.blob_size };
+
+	gut::polymorphic_vector<B> result{ static_cast<size_type>(h.arena_size + h.arena_align - 1) };
+	auto& alloc = result.alloc_;
+	alloc.handles_.reserve(h.count);
+
+	byte* base{ make_aligned(alloc.data_, h.arena_align) };
+	byte* blk{ alloc.data_ };
+	size_type end{ 0 };
+
+	for (size_type i{ 0 }; i != h.count; ++i)
+	{
+		if (indices[i] >= types.size())
+		{
+			throw_corrupt("invalid type index");
+		}
+
+		entry const& e{ *types[indices[i]] };
+		if (offsets[i] < end || e.size > h.arena_size || offsets[i] > h.arena_size - e.size ||
+			(offsets[i] & (e.align - 1)) != 0)
+		{
+			throw_corrupt("invalid element offset");
+		}
+
+		byte* src{ base + offsets[i] };
+		if (e.revive)
+		{
+			e.revive(src, image + offsets[i]);
+		}
+		else if (!e.load(src, blob, blob_end))
+		{
+			throw_corrupt("hook data overrun");
+		}
+
+		alloc.handles_.push_back(e.make_handle(blk, src));
+		end = offsets[i] + e.size;
+		blk = src + e.size;
+
+		if (blob > blob_end)
+		{
+			throw_corrupt("hook data overrun");
+		}
+	}
+
+	alloc.offset_ = blk - alloc.data_;
+	return result;
+}
+//////////////////////////////////////////////////////////////////////////////////
+// private member functions
+//////////////////////////////////////////////////////////////////////////////////
+template<class B>
+inline typename gut::polymorphic_vector_serializer<B>::layout
+gut::polymorphic_vector_serializer<B>::make_layout(header const& h) noexcept
+{
+	layout l;
+	l.types = sizeof(header);
+	l.indices = l.types + h.type_count * sizeof(std::uint32_t);
+	l.offsets = align_up(l.indices + h.count * sizeof(type_index_t), sizeof(std::uint64_t));
+	l.arena = align_up(l.offsets + h.count * sizeof(std::uint64_t),
+		std::max<size_type>(h.arena_align, 64));
+	l.blob = l.arena + h.arena_size;
+	l.end = l.blob + h.blob_size;
+	return l;
+}
+
+template<class B>
+inline typename gut::polymorphic_vector_serializer<B>::size_type
+gut::polymorphic_vector_serializer<B>::align_up(size_type const n, size_type const align) noexcept
+{
+	return (n + align - 1) & ~(align - 1);
+}
+
+template<class B>
+inline void gut::polymorphic_vector_serializer<B>::write_padding(std::ofstream& out,
+	size_type from, size_type const to)
+{
+	static char const zeros[64]{};
+	while (from < to)
+	{
+		size_type const n{ std::min<size_type>(to - from, sizeof(zeros)) };
+		out.write(zeros, n);
+		from += n;
+	}
+}
+
+template<class B>
+inline void gut::polymorphic_vector_serializer<B>::throw_corrupt(char const* what)
+{
+	throw std::runtime_error
+	{
+		std::string{ "polymorphic_vector_serializer<B>::load( ... );\n" } + what
+	};
+}
+#endif // GUT_POLYMORPHIC_VECTOR_SERIALIZER_H
\ No newline at end of file
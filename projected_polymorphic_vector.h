@@ -0,0 +1,463 @@
+#ifndef GUT_PROJECTED_POLYMORPHIC_VECTOR_H
+#define GUT_PROJECTED_POLYMORPHIC_VECTOR_H
+
+#include "polymorphic_vector.h"
+#include <algorithm>
+#include <cassert>
+#include <functional>
+#include <numeric>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace gut
+{
+	namespace detail
+	{
+		template<class B, class T>
+		T const& project(T B::* const member, B const& value) noexcept
+		{
+			return value.*member;
+		}
+
+		template<class B, class R>
+		R project(R (B::* const getter)() const, B const& value)
+		{
+			return (value.*getter)();
+		}
+
+		template<class B, class F>
+		auto project(F const& f, B const& value) -> decltype(f(value))
+		{
+			return f(value);
+		}
+	}
+
+	// polymorphic_vector<B> that keeps a dense column of one projected value
+	// per element, such as a hot member of B. the projection is a pointer to a
+	// data member of B, a const getter of B or any callable taking B const&.
+	//
+	// the column follows every modification made through this class: emplace,
+	// erase, sort and compaction. scans over it touch only the column and
+	// reach back into the elements just for the matching indices. the column
+	// holds copies, so an element changed through a reference must be passed
+	// to update() or refresh() before the column sees it.
+	template<class B, class Projection>
+	class projected_polymorphic_vector
+	{
+	public:
+		using vector_type = gut::polymorphic_vector<B>;
+		using size_type = typename vector_type::size_type;
+		using column_type = std::decay_t<decltype(detail::project(
+			std::declval<Projection const&>(), std::declval<B const&>()))>;
+
+		using reference = typename vector_type::reference;
+		using const_reference = typename vector_type::const_reference;
+		using iterator = typename vector_type::iterator;
+		using const_iterator = typename vector_type::const_iterator;
+
+		explicit projected_polymorphic_vector(Projection projection,
+			size_type const capacity = 0);
+
+		// iterators
+		iterator begin() noexcept;
+		const_iterator begin() const noexcept;
+		iterator end() noexcept;
+		const_iterator end() const noexcept;
+
+		// modifiers
+		template<class D, gut::enable_if_derived_t<B, D> = 0>
+		void push_back(D&& value);
+
+		template<class D, class... Args, gut::enable_if_derived_t<B, D> = 0>
+		void emplace_back(Args&&... args);
+
+		void erase(size_type const i);
+		void erase(size_type const first, size_type const last);
+
+		void pop_back();
+		void clear();
+
+		template<class Compare = std::less<>>
+		void sort(Compare comp = Compare{});
+
+		template<class Compare = std::less<>>
+		void stable_sort(Compare comp = Compare{});
+
+		// orders the elements by their column value
+		template<class Compare = std::less<>>
+		void sort_by_column(Compare comp = Compare{});
+
+		void compact_in_order();
+		size_type compact(gut::packing const p = gut::packing::in_order);
+
+		// calls f(B&) on element i and refreshes its column value
+		template<class F>
+		void update(size_type const i, F&& f);
+
+		void refresh(size_type const i);
+		void refresh();
+
+		// element access
+		reference operator[](size_type const i) noexcept;
+		const_reference operator[](size_type const i) const noexcept;
+
+		reference at(size_type const i);
+		const_reference at(size_type const i) const;
+
+		vector_type const& elements() const noexcept;
+
+		// column access
+		column_type const* column() const noexcept;
+		column_type const& column(size_type const i) const noexcept;
+
+		// appends to out the index of every element whose column value satisfies
+		// pred and returns the number appended. the loop is branch free, so it
+		// vectorizes for simple predicates
+		template<class Pred>
+		size_type select(Pred pred, std::vector<size_type>& out) const;
+
+		// calls f(B&, size_type i) on every element whose column value
+		// satisfies pred
+		template<class Pred, class F>
+		void for_each_matching(Pred pred, F&& f);
+
+		// capacity
+		size_type size() const noexcept;
+		bool empty() const noexcept;
+
+	private:
+		column_type project(B const& value) const;
+
+		template<class Less>
+		void permute(Less less, bool const stable);
+
+		vector_type elements_;
+		std::vector<column_type> column_;
+		Projection projection_;
+	};
+
+	template<class B, class Projection>
+	projected_polymorphic_vector<B, Projection> make_projected(Projection projection,
+		std::size_t const capacity = 0)
+	{
+		return projected_polymorphic_vector<B, Projection>{ projection, capacity };
+	}
+}
+//////////////////////////////////////////////////////////////////////////////////
+// constructors
+//////////////////////////////////////////////////////////////////////////////////
+template<class B, class Projection>
+inline gut::projected_polymorphic_vector<B, Projection>::projected_polymorphic_vector(
+	Projection projection, size_type const capacity)
+	: elements_{ capacity }
+	, projection_(projection)
+{}
+//////////////////////////////////////////////////////////////////////////////////
+// iterators
+//////////////////////////////////////////////////////////////////////////////////
+template<class B, class Projection>
+inline typename gut::projected_polymorphic_vector<B, Projection>::iterator
+gut::projected_polymorphic_vector<B, Projection>::begin() noexcept
+{
+	return elements_.begin();
+}
+
+template<class B, class Projection>
+inline typename gut::projected_polymorphic_vector<B, Projection>::const_iterator
+gut::projected_polymorphic_vector<B, Projection>::begin() const noexcept
+{
+	return elements_.begin();
+}
+
+template<class B, class Projection>
+inline typename gut::projected_polymorphic_vector<B, Projection>::iterator
+gut::projected_polymorphic_vector<B, Projection>::end() noexcept
+{
+	return elements_.end();
+}
+
+template<class B, class Projection>
+inline typename gut::projected_polymorphic_vector<B, Projection>::const_iterator
+gut::projected_polymorphic_vector<B, Projection>::end() const noexcept
+{
+	return elements_.end();
+}
+//////////////////////////////////////////////////////////////////////////////////
+// modifiers
+//////////////////////////////////////////////////////////////////////////////////
+template<class B, class Projection>
+template<class D, gut::enable_if_derived_t<B, D>>
+inline void gut::projected_polymorphic_vector<B, Projection>::push_back(D&& value)
+{
+	emplace_back<std::decay_t<D>>(std::forward<D>(value));
+}
+
+template<class B, class Projection>
+template<class D, class... Args, gut::enable_if_derived_t<B, D>>
+inline void gut::projected_polymorphic_vector<B, Projection>::emplace_back(Args&&... args)
+{
+	elements_.template emplace_back<D>(std::forward<Args>(args)...);
+	try
+	{
+		column_.push_back(project(elements_.back()));
+	}
+	catch (...)
+	{
+		elements_.pop_back();
+		throw;
+	}
+}
+
+template<class B, class Projection>
+inline void gut::projected_polymorphic_vector<B, Projection>::erase(size_type const i)
+{
+	erase(i, i + 1);
+}
+
+template<class B, class Projection>
+inline void gut::projected_polymorphic_vector<B, Projection>::erase(size_type const first,
+	size_type const last)
+{
+	assert(first <= last);
+	assert(last <= column_.size());
+
+	if (first != last)
+	{
+		elements_.alloc_.deallocate(first, last);
+		column_.erase(column_.begin() + first, column_.begin() + last);
+	}
+}
+
+template<class B, class Projection>
+inline void gut::projected_polymorphic_vector<B, Projection>::pop_back()
+{
+	elements_.pop_back();
+	column_.pop_back();
+}
+
+template<class B, class Projection>
+inline void gut::projected_polymorphic_vector<B, Projection>::clear()
+{
+	elements_.clear();
+	column_.clear();
+}
+
+template<class B, class Projection>
+template<class Compare>
+inline void gut::projected_polymorphic_vector<B, Projection>::sort(Compare comp)
+{
+	permute([this, &comp](size_type const x, size_type const y)
+	{
+		return comp(elements_[x], elements_[y]);
+	}, false);
+}
+
+template<class B, class Projection>
+template<class Compare>
+inline void gut::projected_polymorphic_vector<B, Projection>::stable_sort(Compare comp)
+{
+	permute([this, &comp](size_type const x, size_type const y)
+	{
+		return comp(elements_[x], elements_[y]);
+	}, true);
+}
+
+template<class B, class Projection>
+template<class Compare>
+inline void gut::projected_polymorphic_vector<B, Projection>::sort_by_column(Compare comp)
+{
+	permute([this, &comp](size_type const x, size_type const y)
+	{
+		return comp(column_[x], column_[y]);
+	}, true);
+}
+
+template<class B, class Projection>
+inline void gut::projected_polymorphic_vector<B, Projection>::compact_in_order()
+{
+	elements_.compact_in_order();
+}
+
+template<class B, class Projection>
+inline typename gut::projected_polymorphic_vector<B, Projection>::size_type
+gut::projected_polymorphic_vector<B, Projection>::compact(gut::packing const p)
+{
+	// compaction moves objects but keeps the element order, and with it the
+	// column
+	return elements_.compact(p);
+}
+
+template<class B, class Projection>
+template<class F>
+inline void gut::projected_polymorphic_vector<B, Projection>::update(size_type const i, F&& f)
+{
+	f(elements_[i]);
+	column_[i] = project(elements_[i]);
+}
+
+template<class B, class Projection>
+inline void gut::projected_polymorphic_vector<B, Projection>::refresh(size_type const i)
+{
+	column_[i] = project(elements_[i]);
+}
+
+template<class B, class Projection>
+inline void gut::projected_polymorphic_vector<B, Projection>::refresh()
+{
+	for (size_type i{ 0 }, sz{ column_.size() }; i != sz; ++i)
+	{
+		column_[i] = project(elements_[i]);
+	}
+}
+//////////////////////////////////////////////////////////////////////////////////
+// element access
+//////////////////////////////////////////////////////////////////////////////////
+template<class B, class Projection>
+inline typename gut::projected_polymorphic_vector<B, Projection>::reference
+gut::projected_polymorphic_vector<B, Projection>::operator[](size_type const i) noexcept
+{
+	return elements_[i];
+}
+
+template<class B, class Projection>
+inline typename gut::projected_polymorphic_vector<B, Projection>::const_reference
+gut::projected_polymorphic_vector<B, Projection>::operator[](size_type const i) const noexcept
+{
+	return elements_[i];
+}
+
+template<class B, class Projection>
+inline typename gut::projected_polymorphic_vector<B, Projection>::reference
+gut::projected_polymorphic_vector<B, Projection>::at(size_type const i)
+{
+	return elements_.at(i);
+}
+
+template<class B, class Projection>
+inline typename gut::projected_polymorphic_vector<B, Projection>::const_reference
+gut::projected_polymorphic_vector<B, Projection>::at(size_type const i) const
+{
+	return elements_.at(i);
+}
+
+template<class B, class Projection>
+inline typename gut::projected_polymorphic_vector<B, Projection>::vector_type const&
+gut::projected_polymorphic_vector<B, Projection>::elements() const noexcept
+{
+	return elements_;
+}
+//////////////////////////////////////////////////////////////////////////////////
+// column access
+//////////////////////////////////////////////////////////////////////////////////
+template<class B, class Projection>
+inline typename gut::projected_polymorphic_vector<B, Projection>::column_type const*
+gut::projected_polymorphic_vector<B, Projection>::column() const noexcept
+{
+	return column_.data();
+}
+
+template<class B, class Projection>
+inline typename gut::projected_polymorphic_vector<B, Projection>::column_type const&
+gut::projected_polymorphic_vector<B, Projection>::column(size_type const i) const noexcept
+{
+	return column_[i];
+}
+
+template<class B, class Projection>
+template<class Pred>
+typename gut::projected_polymorphic_vector<B, Projection>::size_type
+gut::projected_polymorphic_vector<B, Projection>::select(Pred pred, std::vector<size_type>& out) const
+{
+	size_type const first{ out.size() };
+	size_type const n{ column_.size() };
+
+	// every index is written, and the cursor only advances past matches
+	out.resize(first + n);
+	size_type* dst{ out.data() + first };
+	column_type const* col{ column_.data() };
+
+	size_type matched{ 0 };
+	for (size_type i{ 0 }; i != n; ++i)
+	{
+		dst[matched] = i;
+		matched += static_cast<bool>(pred(col[i]));
+	}
+
+	out.resize(first + matched);
+	return matched;
+}
+
+template<class B, class Projection>
+template<class Pred, class F>
+void gut::projected_polymorphic_vector<B, Projection>::for_each_matching(Pred pred, F&& f)
+{
+	column_type const* col{ column_.data() };
+	for (size_type i{ 0 }, sz{ column_.size() }; i != sz; ++i)
+	{
+		if (pred(col[i]))
+		{
+			f(elements_[i], i);
+		}
+	}
+}
+//////////////////////////////////////////////////////////////////////////////////
+// capacity
+//////////////////////////////////////////////////////////////////////////////////
+template<class B, class Projection>
+inline typename gut::projected_polymorphic_vector<B, Projection>::size_type
+gut::projected_polymorphic_vector<B, Projection>::size() const noexcept
+{
+	return column_.size();
+}
+
+template<class B, class Projection>
+inline bool gut::projected_polymorphic_vector<B, Projection>::empty() const noexcept
+{
+	return column_.empty();
+}
+///////////////////////////////////////////////////////////////////////////////
+// private member functions
+///////////////////////////////////////////////////////////////////////////////
+template<class B, class Projection>
+inline typename gut::projected_polymorphic_vector<B, Projection>::column_type
+gut::projected_polymorphic_vector<B, Projection>::project(B const& value) const
+{
+	return detail::project(projection_, value);
+}
+
+template<class B, class Projection>
+template<class Less>
+void gut::projected_polymorphic_vector<B, Projection>::permute(Less less, bool const stable)
+{
+	size_type const n{ column_.size() };
+
+	std::vector<size_type> order(n);
+	std::iota(order.begin(), order.end(), size_type{ 0 });
+	if (stable)
+	{
+		std::stable_sort(order.begin(), order.end(), less);
+	}
+	else
+	{
+		std::sort(order.begin(), order.end(), less);
+	}
+
+	// handles and column values are permuted alike; the objects stay where
+	// they are, as with polymorphic_vector<B>::sort()
+	auto& handles = elements_.alloc_.handles_;
+	std::vector<gut::polymorphic_handle> sorted_handles(n);
+	std::vector<column_type> sorted_column;
+	sorted_column.reserve(n);
+
+	for (size_type i{ 0 }; i != n; ++i)
+	{
+		sorted_handles[i] = std::move(handles[order[i]]);
+		sorted_column.push_back(std::move(column_[order[i]]));
+	}
+
+	handles.swap(sorted_handles);
+	column_.swap(sorted_column);
+	elements_.alloc_.reordered();
+}
+#endif // GUT_PROJECTED_POLYMORPHIC_VECTOR_H
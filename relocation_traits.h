@@ -0,0 +1,19 @@
+#ifndef GUT_RELOCATION_TRAITS_H
+#define GUT_RELOCATION_TRAITS_H
+
+#include <type_traits>
+
+namespace gut
+{
+	// a type is trivially relocatable when copying its bytes to a new address
+	// and abandoning the old ones (without running the destructor) yields an
+	// equivalent object. this holds for most polymorphic types in practice, but
+	// cannot be detected, so types opt in by specializing this trait:
+	//
+	//     template<> struct gut::is_trivially_relocatable<my_type> : std::true_type {};
+	template<class T>
+	struct is_trivially_relocatable
+		: std::is_trivially_copyable<T>
+	{};
+}
+#endif // GUT_RELOCATION_TRAITS_H
\ No newline at end of file
@@ -0,0 +1,486 @@
+#ifndef GUT_SHARED_POLYMORPHIC_VECTOR_H
+#define GUT_SHARED_POLYMORPHIC_VECTOR_H
+
+#include "polymorphic_vector.h"
+#include "relocation_traits.h"
+#include "shared_segment.h"
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <new>
+#include <stdexcept>
+#include <typeinfo>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace gut
+{
+	namespace detail
+	{
+		// the start of a segment written by shared_polymorphic_vector. every
+		// position in the segment is an offset from its start, so the mapping
+		// may sit at a different address in every process and move on growth
+		struct shared_header
+		{
+			static constexpr std::uint64_t magic_value{ 0x6775747368617265ull };
+			static constexpr std::size_t page_size{ 4096 };
+
+			std::uint64_t magic;
+
+			// address of typeid(B) in the writing process
+			std::uint64_t anchor;
+
+			// slots in the offset table, which follows the header
+			std::uint64_t capacity;
+			std::uint64_t table_offset;
+			std::uint64_t arena_offset;
+
+			// bytes in use behind arena_offset
+			std::uint64_t used;
+
+			// written before count is published, so a reader that sees count
+			// also sees a size covering every published element
+			std::uint64_t segment_size;
+
+			std::atomic<std::uint64_t> count;
+		};
+
+		static_assert(ATOMIC_LLONG_LOCK_FREE == 2,
+			"the published count must be lock free to be shared between processes");
+	}
+
+	// writer of a polymorphic_vector<B> living in a gut::shared_segment, for
+	// zero-copy hand-off to other processes that map the segment read-only
+	// through shared_polymorphic_view<B>.
+	//
+	// elements are found through a table of arena offsets instead of handles
+	// holding addresses, so growing the segment, which can move its mapping,
+	// needs no fix-ups, and every process resolves the same table against its
+	// own mapping. like spmc_polymorphic_vector, the size is published with a
+	// release store after the element is complete.
+	//
+	// the objects are used in place by the readers, vptr included. that only
+	// works for processes running the same binary at the same load address: a
+	// non-PIE build, or one with address randomization turned off. the view
+	// checks this before handing out any element. the types stored must be
+	// gut::is_trivially_relocatable and hold no pointers into the writer's
+	// memory, such as a std::string on the heap.
+	template<class B>
+	class shared_polymorphic_vector
+	{
+	public:
+		using byte = gut::shared_segment::byte;
+
+		using value_type = B;
+		using reference = value_type&;
+		using const_reference = value_type const&;
+		using pointer = value_type*;
+		using const_pointer = value_type const*;
+
+		using size_type = gut::shared_segment::size_type;
+
+		// destructor
+		~shared_polymorphic_vector();
+
+		// constructors; the segment must be writable, and is laid out afresh
+		shared_polymorphic_vector(gut::shared_segment segment, size_type const max_elements);
+
+		shared_polymorphic_vector(shared_polymorphic_vector&&) = default;
+		shared_polymorphic_vector& operator=(shared_polymorphic_vector&& other);
+
+		shared_polymorphic_vector(shared_polymorphic_vector const&) = delete;
+		shared_polymorphic_vector& operator=(shared_polymorphic_vector const&) = delete;
+
+		// modifiers
+		template<class D, gut::enable_if_derived_t<B, D> = 0>
+		void push_back(D&& value);
+
+		template<class D, class... Args, gut::enable_if_derived_t<B, D> = 0>
+		void emplace_back(Args&&... args);
+
+		// requires that no reader is accessing the segment
+		void clear();
+
+		// element access
+		reference operator[](size_type const i) noexcept;
+		const_reference operator[](size_type const i) const noexcept;
+
+		reference at(size_type const i);
+		const_reference at(size_type const i) const;
+
+		// capacity
+		size_type size() const noexcept;
+		bool empty() const noexcept;
+		size_type capacity() const noexcept;
+
+		// the segment, whose name or descriptor is handed to the readers
+		gut::shared_segment const& segment() const noexcept;
+
+	private:
+		detail::shared_header& header() noexcept;
+		detail::shared_header const& header() const noexcept;
+		std::uint64_t const* table() const noexcept;
+		byte* arena() noexcept;
+
+		void ensure_index_bounds(size_type const i) const;
+
+		gut::shared_segment segment_;
+
+		// process local; the readers never destroy anything
+		std::vector<void(*)(void*)> destroy_;
+	};
+
+	// read-only view of a segment written by shared_polymorphic_vector<B> in
+	// another process, or this one
+	template<class B>
+	class shared_polymorphic_view
+	{
+	public:
+		using byte = gut::shared_segment::byte;
+
+		using value_type = B;
+		using const_reference = value_type const&;
+		using const_pointer = value_type const*;
+
+		using size_type = gut::shared_segment::size_type;
+
+		// throws std::runtime_error if the segment was not written by a
+		// shared_polymorphic_vector<B> of a process at this load address
+		explicit shared_polymorphic_view(gut::shared_segment segment);
+
+		// takes in the elements published since the last refresh, remapping
+		// the segment if the writer grew it, and returns the new size
+		size_type refresh();
+
+		// element access, to the elements seen by the last refresh
+		const_reference operator[](size_type const i) const noexcept;
+		const_reference at(size_type const i) const;
+
+		size_type size() const noexcept;
+		bool empty() const noexcept;
+
+	private:
+		detail::shared_header const& header() const noexcept;
+
+		gut::shared_segment segment_;
+		size_type size_;
+	};
+}
+//////////////////////////////////////////////////////////////////////////////////
+// destructor
+//////////////////////////////////////////////////////////////////////////////////
+template<class B>
+inline gut::shared_polymorphic_vector<B>::~shared_polymorphic_vector()
+{
+	if (segment_.data())
+	{
+		clear();
+	}
+}
+//////////////////////////////////////////////////////////////////////////////////
+// constructors/assignment
+//////////////////////////////////////////////////////////////////////////////////
+template<class B>
+gut::shared_polymorphic_vector<B>::shared_polymorphic_vector(gut::shared_segment segment,
+	size_type const max_elements)
+	: segment_{ std::move(segment) }
+{
+	if (!segment_.writable())
+	{
+		throw std::invalid_argument
+		{
+			"shared_polymorphic_vector<B>::shared_polymorphic_vector( gut::shared_segment segment, size_type const max_elements );\n"
+			"the segment is read-only"
+		};
+	}
+
+	// the arena starts on a page, as does every mapping of it, so an offset
+	// aligned for a type is an address aligned for it in every process
+	size_type const page{ detail::shared_header::page_size };
+	size_type const table_offset{ (sizeof(detail::shared_header) + 63) & ~size_type{ 63 } };
+	size_type const arena_offset{ (table_offset + max_elements * sizeof(std::uint64_t) + page - 1) & ~(page - 1) };
+
+	if (segment_.size() < arena_offset + page)
+	{
+		segment_.resize(arena_offset + page);
+	}
+	destroy_.reserve(max_elements);
+
+	auto h = ::new (segment_.data()) detail::shared_header{};
+	h->magic = detail::shared_header::magic_value;
+	h->anchor = reinterpret_cast<std::uintptr_t>(&typeid(B));
+	h->capacity = max_elements;
+	h->table_offset = table_offset;
+	h->arena_offset = arena_offset;
+	h->used = 0;
+	h->segment_size = segment_.size();
+	h->count.store(0, std::memory_order_release);
+}
+
+template<class B>
+inline gut::shared_polymorphic_vector<B>& gut::shared_polymorphic_vector<B>::operator=(
+	shared_polymorphic_vector&& other)
+{
+	if (this != &other)
+	{
+		// the elements are destroyed while their segment is still mapped
+		if (segment_.data())
+		{
+			clear();
+		}
+		segment_ = std::move(other.segment_);
+		destroy_ = std::move(other.destroy_);
+		other.destroy_.clear();
+	}
+	return *this;
+}
+//////////////////////////////////////////////////////////////////////////////////
+// modifiers
+//////////////////////////////////////////////////////////////////////////////////
+template<class B>
+template<class D, gut::enable_if_derived_t<B, D>>
+inline void gut::shared_polymorphic_vector<B>::push_back(D&& value)
+{
+	emplace_back<std::decay_t<D>>(std::forward<D>(value));
+}
+
+template<class B>
+template<class D, class... Args, gut::enable_if_derived_t<B, D>>
+void gut::shared_polymorphic_vector<B>::emplace_back(Args&&... args)
+{
+	static_assert(gut::is_trivially_relocatable<D>::value,
+		"objects in a shared segment move with its mapping, so D must be trivially relocatable");
+	static_assert(alignof(D) <= detail::shared_header::page_size,
+		"D is aligned beyond the page the arena starts on");
+
+	size_type const n{ size() };
+	if (n == header().capacity)
+	{
+		throw std::length_error
+		{
+			"shared_polymorphic_vector<B>::emplace_back( Args&&... args );\n"
+			"offset table full"
+		};
+	}
+
+	size_type const offset{ (header().used + alignof(D) - 1) & ~(alignof(D) - 1) };
+	size_type const required{ header().arena_offset + offset + sizeof(D) };
+
+	if (required > segment_.size())
+	{
+		// the mapping may move; the offsets already published stay valid
+		segment_.resize(std::max(segment_.size() * 2, required));
+		header().segment_size = segment_.size();
+	}
+
+	::new (arena() + offset) D{ std::forward<Args>(args)... };
+	destroy_.push_back([](void* p)
+	{
+		static_cast<D*>(p)->~D();
+	});
+
+	auto& h = header();
+	const_cast<std::uint64_t*>(table())[n] = offset;
+	h.used = offset + sizeof(D);
+	h.count.store(n + 1, std::memory_order_release);
+}
+
+template<class B>
+void gut::shared_polymorphic_vector<B>::clear()
+{
+	auto& h = header();
+	size_type const n{ size() };
+	h.count.store(0, std::memory_order_release);
+
+	for (size_type i{ 0 }; i != n; ++i)
+	{
+		destroy_[i](arena() + table()[i]);
+	}
+	destroy_.clear();
+	h.used = 0;
+}
+//////////////////////////////////////////////////////////////////////////////////
+// element access
+//////////////////////////////////////////////////////////////////////////////////
+template<class B>
+inline typename gut::shared_polymorphic_vector<B>::reference
+gut::shared_polymorphic_vector<B>::operator[](size_type const i) noexcept
+{
+	return *reinterpret_cast<pointer>(arena() + table()[i]);
+}
+
+template<class B>
+inline typename gut::shared_polymorphic_vector<B>::const_reference
+gut::shared_polymorphic_vector<B>::operator[](size_type const i) const noexcept
+{
+	return *reinterpret_cast<const_pointer>(segment_.data() + header().arena_offset + table()[i]);
+}
+
+template<class B>
+inline typename gut::shared_polymorphic_vector<B>::reference
+gut::shared_polymorphic_vector<B>::at(size_type const i)
+{
+	ensure_index_bounds(i);
+	return (*this)[i];
+}
+
+template<class B>
+inline typename gut::shared_polymorphic_vector<B>::const_reference
+gut::shared_polymorphic_vector<B>::at(size_type const i) const
+{
+	ensure_index_bounds(i);
+	return (*this)[i];
+}
+//////////////////////////////////////////////////////////////////////////////////
+// capacity
+//////////////////////////////////////////////////////////////////////////////////
+template<class B>
+inline typename gut::shared_polymorphic_vector<B>::size_type
+gut::shared_polymorphic_vector<B>::size() const noexcept
+{
+	return static_cast<size_type>(header().count.load(std::memory_order_relaxed));
+}
+
+template<class B>
+inline bool gut::shared_polymorphic_vector<B>::empty() const noexcept
+{
+	return size() == 0;
+}
+
+template<class B>
+inline typename gut::shared_polymorphic_vector<B>::size_type
+gut::shared_polymorphic_vector<B>::capacity() const noexcept
+{
+	return static_cast<size_type>(header().capacity);
+}
+
+template<class B>
+inline gut::shared_segment const& gut::shared_polymorphic_vector<B>::segment() const noexcept
+{
+	return segment_;
+}
+///////////////////////////////////////////////////////////////////////////////
+// private member functions
+///////////////////////////////////////////////////////////////////////////////
+template<class B>
+inline gut::detail::shared_header& gut::shared_polymorphic_vector<B>::header() noexcept
+{
+	return *reinterpret_cast<detail::shared_header*>(segment_.data());
+}
+
+template<class B>
+inline gut::detail::shared_header const& gut::shared_polymorphic_vector<B>::header() const noexcept
+{
+	return *reinterpret_cast<detail::shared_header const*>(segment_.data());
+}
+
+template<class B>
+inline std::uint64_t const* gut::shared_polymorphic_vector<B>::table() const noexcept
+{
+	return reinterpret_cast<std::uint64_t const*>(segment_.data() + header().table_offset);
+}
+
+template<class B>
+inline typename gut::shared_polymorphic_vector<B>::byte* gut::shared_polymorphic_vector<B>::arena() noexcept
+{
+	return segment_.data() + header().arena_offset;
+}
+
+template<class B>
+inline void gut::shared_polymorphic_vector<B>::ensure_index_bounds(size_type const i) const
+{
+	if (i >= size())
+	{
+		throw std::out_of_range
+		{
+			"shared_polymorphic_vector<B>::ensure_index_bounds( size_type const i );\n"
+			"index out of range"
+		};
+	}
+}
+//////////////////////////////////////////////////////////////////////////////////
+// view
+//////////////////////////////////////////////////////////////////////////////////
+template<class B>
+gut::shared_polymorphic_view<B>::shared_polymorphic_view(gut::shared_segment segment)
+	: segment_{ std::move(segment) }
+	, size_{ 0 }
+{
+	if (segment_.size() < sizeof(detail::shared_header) ||
+		header().magic != detail::shared_header::magic_value)
+	{
+		throw std::runtime_error
+		{
+			"shared_polymorphic_view<B>::shared_polymorphic_view( gut::shared_segment segment );\n"
+			"not a shared_polymorphic_vector segment"
+		};
+	}
+
+	if (header().anchor != reinterpret_cast<std::uintptr_t>(&typeid(B)))
+	{
+		throw std::runtime_error
+		{
+			"shared_polymorphic_view<B>::shared_polymorphic_view( gut::shared_segment segment );\n"
+			"written by another binary or at another load address; the vptrs in the segment are not valid here"
+		};
+	}
+	refresh();
+}
+
+template<class B>
+typename gut::shared_polymorphic_view<B>::size_type gut::shared_polymorphic_view<B>::refresh()
+{
+	size_type const n{ static_cast<size_type>(header().count.load(std::memory_order_acquire)) };
+	if (header().segment_size > segment_.size())
+	{
+		segment_.remap();
+	}
+	size_ = n;
+	return size_;
+}
+
+template<class B>
+inline typename gut::shared_polymorphic_view<B>::const_reference
+gut::shared_polymorphic_view<B>::operator[](size_type const i) const noexcept
+{
+	assert(i < size_);
+	auto const& h = header();
+	auto const table = reinterpret_cast<std::uint64_t const*>(segment_.data() + h.table_offset);
+	return *reinterpret_cast<const_pointer>(segment_.data() + h.arena_offset + table[i]);
+}
+
+template<class B>
+inline typename gut::shared_polymorphic_view<B>::const_reference
+gut::shared_polymorphic_view<B>::at(size_type const i) const
+{
+	if (i >= size_)
+	{
+		throw std::out_of_range
+		{
+			"shared_polymorphic_view<B>::at( size_type const i );\n"
+			"index out of range"
+		};
+	}
+	return (*this)[i];
+}
+
+template<class B>
+inline typename gut::shared_polymorphic_view<B>::size_type gut::shared_polymorphic_view<B>::size() const noexcept
+{
+	return size_;
+}
+
+template<class B>
+inline bool gut::shared_polymorphic_view<B>::empty() const noexcept
+{
+	return size_ == 0;
+}
+
+template<class B>
+inline gut::detail::shared_header const& gut::shared_polymorphic_view<B>::header() const noexcept
+{
+	return *reinterpret_cast<detail::shared_header const*>(segment_.data());
+}
+#endif // GUT_SHARED_POLYMORPHIC_VECTOR_H
@@ -0,0 +1,272 @@
+#include "shared_segment.h"
+#include <stdexcept>
+#include <string>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define GUT_HAS_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+using byte = gut::shared_segment::byte;
+using size_type = gut::shared_segment::size_type;
+
+namespace
+{
+	[[noreturn]] void throw_segment_error(char const* function, char const* what)
+	{
+		throw std::runtime_error
+		{
+			std::string{ "shared_segment::" } + function + ";\n" + what
+		};
+	}
+
+#ifdef GUT_HAS_MMAP
+	int anonymous_fd()
+	{
+#ifdef SYS_memfd_create
+		int const memfd{ static_cast<int>(::syscall(SYS_memfd_create, "gut_shared_segment", 0)) };
+		if (memfd >= 0)
+		{
+			return memfd;
+		}
+#endif
+		// without memfd, a named segment that is unlinked right away is just
+		// as anonymous
+		std::string const name{ "/gut_shared_segment_" + std::to_string(::getpid()) };
+		int const fd{ ::shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600) };
+		if (fd >= 0)
+		{
+			::shm_unlink(name.c_str());
+		}
+		return fd;
+	}
+#endif
+}
+//////////////////////////////////////////////////////////////////////////////////
+// destructor
+//////////////////////////////////////////////////////////////////////////////////
+gut::shared_segment::~shared_segment() noexcept
+{
+	release();
+}
+//////////////////////////////////////////////////////////////////////////////////
+// constructors/assignment
+//////////////////////////////////////////////////////////////////////////////////
+gut::shared_segment gut::shared_segment::create(char const* name, size_type const size)
+{
+#ifdef GUT_HAS_MMAP
+	int const fd{ name
+		? ::shm_open(name, O_RDWR | O_CREAT | O_TRUNC, 0600)
+		: anonymous_fd() };
+
+	if (fd < 0)
+	{
+		throw_segment_error("create( char const* name, size_type const size )",
+			"unable to create the segment");
+	}
+
+	shared_segment s{ fd, true };
+	s.resize(size);
+	return s;
+#else
+	(void)name;
+	(void)size;
+	throw_segment_error("create( char const* name, size_type const size )",
+		"shared memory is not supported on this platform");
+#endif
+}
+
+gut::shared_segment gut::shared_segment::open(char const* name)
+{
+#ifdef GUT_HAS_MMAP
+	int const fd{ ::shm_open(name, O_RDONLY, 0) };
+	if (fd < 0)
+	{
+		throw_segment_error("open( char const* name )", "unable to open the segment");
+	}
+
+	shared_segment s{ fd, false };
+	s.remap();
+	return s;
+#else
+	(void)name;
+	throw_segment_error("open( char const* name )",
+		"shared memory is not supported on this platform");
+#endif
+}
+
+gut::shared_segment gut::shared_segment::open(int const fd)
+{
+#ifdef GUT_HAS_MMAP
+	int const own{ ::fcntl(fd, F_DUPFD_CLOEXEC, 0) };
+	if (own < 0)
+	{
+		throw_segment_error("open( int const fd )", "unable to duplicate the descriptor");
+	}
+
+	shared_segment s{ own, false };
+	s.remap();
+	return s;
+#else
+	(void)fd;
+	throw_segment_error("open( int const fd )",
+		"shared memory is not supported on this platform");
+#endif
+}
+
+gut::shared_segment::shared_segment(int const fd, bool const writable)
+	: data_{ nullptr }
+	, size_{ 0 }
+	, fd_{ fd }
+	, writable_{ writable }
+{}
+
+gut::shared_segment::shared_segment(shared_segment&& other) noexcept
+	: data_{ other.data_ }
+	, size_{ other.size_ }
+	, fd_{ other.fd_ }
+	, writable_{ other.writable_ }
+{
+	other.data_ = nullptr;
+	other.size_ = 0;
+	other.fd_ = -1;
+}
+
+gut::shared_segment& gut::shared_segment::operator=(shared_segment&& other) noexcept
+{
+	if (this != &other)
+	{
+		release();
+		data_ = other.data_;
+		size_ = other.size_;
+		fd_ = other.fd_;
+		writable_ = other.writable_;
+		other.data_ = nullptr;
+		other.size_ = 0;
+		other.fd_ = -1;
+	}
+	return *this;
+}
+//////////////////////////////////////////////////////////////////////////////////
+// member access
+//////////////////////////////////////////////////////////////////////////////////
+byte* gut::shared_segment::data() noexcept
+{
+	return data_;
+}
+
+byte const* gut::shared_segment::data() const noexcept
+{
+	return data_;
+}
+
+size_type gut::shared_segment::size() const noexcept
+{
+	return size_;
+}
+
+bool gut::shared_segment::writable() const noexcept
+{
+	return writable_;
+}
+
+int gut::shared_segment::fd() const noexcept
+{
+	return fd_;
+}
+//////////////////////////////////////////////////////////////////////////////////
+// modifiers
+//////////////////////////////////////////////////////////////////////////////////
+void gut::shared_segment::resize(size_type const size)
+{
+#ifdef GUT_HAS_MMAP
+	if (!writable_)
+	{
+		throw_segment_error("resize( size_type const size )", "the segment is read-only");
+	}
+
+	if (::ftruncate(fd_, static_cast<off_t>(size)) != 0)
+	{
+		throw_segment_error("resize( size_type const size )", "unable to resize the segment");
+	}
+	map(size);
+#else
+	(void)size;
+#endif
+}
+
+void gut::shared_segment::remap()
+{
+#ifdef GUT_HAS_MMAP
+	struct stat st;
+	if (::fstat(fd_, &st) != 0)
+	{
+		throw_segment_error("remap()", "unable to read the segment size");
+	}
+	map(static_cast<size_type>(st.st_size));
+#endif
+}
+
+void gut::shared_segment::unlink(char const* name) noexcept
+{
+#ifdef GUT_HAS_MMAP
+	::shm_unlink(name);
+#else
+	(void)name;
+#endif
+}
+//////////////////////////////////////////////////////////////////////////////////
+// private member functions
+//////////////////////////////////////////////////////////////////////////////////
+void gut::shared_segment::map(size_type const size)
+{
+#ifdef GUT_HAS_MMAP
+	if (size == size_)
+	{
+		return;
+	}
+
+	void* p{ nullptr };
+	if (size != 0)
+	{
+		int const prot{ writable_ ? PROT_READ | PROT_WRITE : PROT_READ };
+		p = ::mmap(nullptr, size, prot, MAP_SHARED, fd_, 0);
+		if (p == MAP_FAILED)
+		{
+			throw_segment_error("map( size_type const size )", "unable to map the segment");
+		}
+	}
+
+	// the new mapping is in place before the old one goes, so a failure
+	// leaves the segment as it was
+	if (data_)
+	{
+		::munmap(data_, size_);
+	}
+	data_ = static_cast<byte*>(p);
+	size_ = size;
+#else
+	(void)size;
+#endif
+}
+
+void gut::shared_segment::release() noexcept
+{
+#ifdef GUT_HAS_MMAP
+	if (data_)
+	{
+		::munmap(data_, size_);
+	}
+	if (fd_ >= 0)
+	{
+		::close(fd_);
+	}
+#endif
+	data_ = nullptr;
+	size_ = 0;
+	fd_ = -1;
+}
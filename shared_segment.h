@@ -0,0 +1,66 @@
+#ifndef GUT_SHARED_SEGMENT_H
+#define GUT_SHARED_SEGMENT_H
+
+#include <cstddef>
+
+namespace gut
+{
+	// a shared memory segment mapped into this process. create() makes a new,
+	// writable segment: anonymous through memfd when no name is given, so it
+	// can be handed to another process as a file descriptor, or named through
+	// shm_open. open() maps an existing segment read-only.
+	//
+	// the segment is a file, so growing it keeps its contents but can move the
+	// mapping; anything stored inside should refer to other parts of it by
+	// offset rather than by address.
+	class shared_segment
+	{
+	public:
+		using byte = unsigned char;
+		using size_type = std::size_t;
+
+		~shared_segment() noexcept;
+
+		static shared_segment create(char const* name, size_type const size);
+		static shared_segment open(char const* name);
+
+		// maps a segment received as a file descriptor; the descriptor is
+		// duplicated, so the caller keeps ownership of fd
+		static shared_segment open(int const fd);
+
+		shared_segment(shared_segment&& other) noexcept;
+		shared_segment& operator=(shared_segment&& other) noexcept;
+
+		shared_segment(shared_segment const&) = delete;
+		shared_segment& operator=(shared_segment const&) = delete;
+
+		byte* data() noexcept;
+		byte const* data() const noexcept;
+		size_type size() const noexcept;
+
+		bool writable() const noexcept;
+		int fd() const noexcept;
+
+		// grows or shrinks a writable segment; the mapping may move
+		void resize(size_type const size);
+
+		// maps the current size of the segment, which another process may have
+		// grown; the mapping may move
+		void remap();
+
+		// removes a named segment; mappings that exist stay valid
+		static void unlink(char const* name) noexcept;
+
+	private:
+		shared_segment(int const fd, bool const writable);
+
+		void map(size_type const size);
+		void release() noexcept;
+
+		byte* data_;
+		size_type size_;
+		int fd_;
+		bool writable_;
+	};
+}
+#endif // GUT_SHARED_SEGMENT_H
@@ -0,0 +1,207 @@
+#include "simd_kernels.h"
+#include <cstdint>
+
+#if (defined(__x86_64__) || defined(_M_X64)) && SIZE_MAX == UINT64_MAX
+#define GUT_SIMD_X64
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define GUT_TARGET_AVX2
+#else
+#define GUT_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+using size_type = std::size_t;
+
+namespace
+{
+	//////////////////////////////////////////////////////////////////////////////
+	// scalar
+	//////////////////////////////////////////////////////////////////////////////
+	void add_scalar(size_type* p, size_type const n, size_type const delta) noexcept
+	{
+		for (size_type i{ 0 }; i != n; ++i)
+		{
+			p[i] += delta;
+		}
+	}
+
+	size_type exclusive_scan_scalar(size_type const* in, size_type* out,
+		size_type const n, size_type sum) noexcept
+	{
+		for (size_type i{ 0 }; i != n; ++i)
+		{
+			size_type const v{ in[i] };
+			out[i] = sum;
+			sum += v;
+		}
+		return sum;
+	}
+
+#ifdef GUT_SIMD_X64
+	//////////////////////////////////////////////////////////////////////////////
+	// sse2, part of every x86-64 CPU
+	//////////////////////////////////////////////////////////////////////////////
+	void add_sse2(size_type* p, size_type const n, size_type const delta) noexcept
+	{
+		__m128i const d{ _mm_set1_epi64x(static_cast<long long>(delta)) };
+
+		size_type i{ 0 };
+		for (; i + 2 <= n; i += 2)
+		{
+			auto const q = reinterpret_cast<__m128i*>(p + i);
+			_mm_storeu_si128(q, _mm_add_epi64(_mm_loadu_si128(q), d));
+		}
+		add_scalar(p + i, n - i, delta);
+	}
+
+	size_type exclusive_scan_sse2(size_type const* in, size_type* out,
+		size_type const n, size_type const init) noexcept
+	{
+		__m128i carry{ _mm_set1_epi64x(static_cast<long long>(init)) };
+
+		size_type i{ 0 };
+		for (; i + 2 <= n; i += 2)
+		{
+			__m128i const x{ _mm_loadu_si128(reinterpret_cast<__m128i const*>(in + i)) };
+
+			// [x0, x1] -> [0, x0]: the exclusive scan of the pair
+			__m128i const e{ _mm_slli_si128(x, 8) };
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_add_epi64(e, carry));
+
+			// carry the pair's total into both lanes
+			__m128i const s{ _mm_add_epi64(x, e) };
+			carry = _mm_add_epi64(carry, _mm_shuffle_epi32(s, _MM_SHUFFLE(3, 2, 3, 2)));
+		}
+
+		return exclusive_scan_scalar(in + i, out + i, n - i,
+			static_cast<size_type>(_mm_cvtsi128_si64(carry)));
+	}
+
+	//////////////////////////////////////////////////////////////////////////////
+	// avx2
+	//////////////////////////////////////////////////////////////////////////////
+	GUT_TARGET_AVX2
+	void add_avx2(size_type* p, size_type const n, size_type const delta) noexcept
+	{
+		__m256i const d{ _mm256_set1_epi64x(static_cast<long long>(delta)) };
+
+		size_type i{ 0 };
+		for (; i + 8 <= n; i += 8)
+		{
+			auto const q = reinterpret_cast<__m256i*>(p + i);
+			_mm256_storeu_si256(q, _mm256_add_epi64(_mm256_loadu_si256(q), d));
+			_mm256_storeu_si256(q + 1, _mm256_add_epi64(_mm256_loadu_si256(q + 1), d));
+		}
+		for (; i + 4 <= n; i += 4)
+		{
+			auto const q = reinterpret_cast<__m256i*>(p + i);
+			_mm256_storeu_si256(q, _mm256_add_epi64(_mm256_loadu_si256(q), d));
+		}
+		add_scalar(p + i, n - i, delta);
+	}
+
+	GUT_TARGET_AVX2
+	size_type exclusive_scan_avx2(size_type const* in, size_type* out,
+		size_type const n, size_type const init) noexcept
+	{
+		__m256i const zero{ _mm256_setzero_si256() };
+		__m256i carry{ _mm256_set1_epi64x(static_cast<long long>(init)) };
+
+		size_type i{ 0 };
+		for (; i + 4 <= n; i += 4)
+		{
+			__m256i const x{ _mm256_loadu_si256(reinterpret_cast<__m256i const*>(in + i)) };
+
+			// log-step inclusive scan across the four lanes: shift by one lane,
+			// add, shift by two lanes, add
+			__m256i s{ _mm256_add_epi64(x, _mm256_blend_epi32(
+				_mm256_permute4x64_epi64(x, _MM_SHUFFLE(2, 1, 0, 0)), zero, 0x03)) };
+			s = _mm256_add_epi64(s, _mm256_blend_epi32(
+				_mm256_permute4x64_epi64(s, _MM_SHUFFLE(1, 0, 0, 0)), zero, 0x0F));
+
+			// the exclusive scan is the inclusive one minus the inputs
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i),
+				_mm256_add_epi64(_mm256_sub_epi64(s, x), carry));
+
+			carry = _mm256_add_epi64(carry, _mm256_permute4x64_epi64(s, _MM_SHUFFLE(3, 3, 3, 3)));
+		}
+
+		return exclusive_scan_scalar(in + i, out + i, n - i,
+			static_cast<size_type>(_mm256_extract_epi64(carry, 0)));
+	}
+
+	bool cpu_has_avx2() noexcept
+	{
+#if defined(_MSC_VER) && !defined(__clang__)
+		int regs[4];
+		__cpuid(regs, 0);
+		if (regs[0] < 7)
+		{
+			return false;
+		}
+
+		// the OS must save the ymm registers as well
+		__cpuid(regs, 1);
+		bool const osxsave{ (regs[2] & (1 << 27)) != 0 };
+		if (!osxsave || (_xgetbv(0) & 0x6) != 0x6)
+		{
+			return false;
+		}
+
+		__cpuidex(regs, 7, 0);
+		return (regs[1] & (1 << 5)) != 0;
+#else
+		return __builtin_cpu_supports("avx2") != 0;
+#endif
+	}
+#endif
+
+	//////////////////////////////////////////////////////////////////////////////
+	// dispatch
+	//////////////////////////////////////////////////////////////////////////////
+	struct kernels
+	{
+		gut::simd::isa isa;
+		void (*add)(size_type*, size_type, size_type) noexcept;
+		size_type (*exclusive_scan)(size_type const*, size_type*, size_type, size_type) noexcept;
+	};
+
+	kernels select_kernels() noexcept
+	{
+#ifdef GUT_SIMD_X64
+		if (cpu_has_avx2())
+		{
+			return{ gut::simd::isa::avx2, &add_avx2, &exclusive_scan_avx2 };
+		}
+		return{ gut::simd::isa::sse2, &add_sse2, &exclusive_scan_sse2 };
+#else
+		return{ gut::simd::isa::scalar, &add_scalar, &exclusive_scan_scalar };
+#endif
+	}
+
+	kernels const& active() noexcept
+	{
+		static kernels const k{ select_kernels() };
+		return k;
+	}
+}
+//////////////////////////////////////////////////////////////////////////////////
+// kernels
+//////////////////////////////////////////////////////////////////////////////////
+gut::simd::isa gut::simd::active_isa() noexcept
+{
+	return active().isa;
+}
+
+void gut::simd::add(size_type* p, size_type const n, size_type const delta) noexcept
+{
+	active().add(p, n, delta);
+}
+
+size_type gut::simd::exclusive_scan(size_type const* in, size_type* out,
+	size_type const n, size_type const init) noexcept
+{
+	return active().exclusive_scan(in, out, n, init);
+}
@@ -0,0 +1,33 @@
+#ifndef GUT_SIMD_KERNELS_H
+#define GUT_SIMD_KERNELS_H
+
+#include <cstddef>
+
+namespace gut
+{
+	// bulk kernels over arrays of offsets and sizes. each one is implemented
+	// with AVX2, SSE2 and plain scalar code; the widest variant the running
+	// CPU supports is picked on first use.
+	namespace simd
+	{
+		enum class isa
+		{
+			scalar,
+			sse2,
+			avx2
+		};
+
+		// the instruction set the kernels dispatch to
+		isa active_isa() noexcept;
+
+		// p[i] += delta for every i in [0, n); unsigned wrap-around makes a
+		// "negative" delta subtract
+		void add(std::size_t* p, std::size_t const n, std::size_t const delta) noexcept;
+
+		// out[i] = init + in[0] + ... + in[i - 1] and returns init plus the sum
+		// of all n values; in and out may be the same array
+		std::size_t exclusive_scan(std::size_t const* in, std::size_t* out,
+			std::size_t const n, std::size_t const init) noexcept;
+	}
+}
+#endif // GUT_SIMD_KERNELS_H
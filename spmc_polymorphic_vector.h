@@ -0,0 +1,363 @@
+#ifndef GUT_SPMC_POLYMORPHIC_VECTOR_H
+#define GUT_SPMC_POLYMORPHIC_VECTOR_H
+
+#include "contiguous_allocator.h"
+#include "polymorphic_vector.h"
+#include <atomic>
+#include <cassert>
+#include <iterator>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+namespace gut
+{
+	template<class B> class spmc_polymorphic_vector;
+
+	// read-only iterator over the published prefix of a spmc_polymorphic_vector;
+	// it never touches the handle vector's size, which the producer is writing
+	template<class B>
+	class spmc_polymorphic_vector_iterator final
+	{
+	public:
+		using iterator_category = std::random_access_iterator_tag;
+		using value_type = B;
+		using difference_type = std::ptrdiff_t;
+		using pointer = B const*;
+		using reference = B const&;
+
+		spmc_polymorphic_vector_iterator() noexcept
+			: h_{ nullptr }
+		{}
+
+		reference operator*() const noexcept
+		{
+			return *reinterpret_cast<pointer>((*h_)->src());
+		}
+
+		pointer operator->() const noexcept
+		{
+			return reinterpret_cast<pointer>((*h_)->src());
+		}
+
+		reference operator[](difference_type const i) const noexcept
+		{
+			return *reinterpret_cast<pointer>(h_[i]->src());
+		}
+
+		spmc_polymorphic_vector_iterator& operator++() noexcept
+		{
+			++h_;
+			return *this;
+		}
+
+		spmc_polymorphic_vector_iterator& operator--() noexcept
+		{
+			--h_;
+			return *this;
+		}
+
+		spmc_polymorphic_vector_iterator operator++(int) noexcept
+		{
+			return spmc_polymorphic_vector_iterator{ h_++ };
+		}
+
+		spmc_polymorphic_vector_iterator operator--(int) noexcept
+		{
+			return spmc_polymorphic_vector_iterator{ h_-- };
+		}
+
+		spmc_polymorphic_vector_iterator& operator+=(difference_type const n) noexcept
+		{
+			h_ += n;
+			return *this;
+		}
+
+		spmc_polymorphic_vector_iterator& operator-=(difference_type const n) noexcept
+		{
+			h_ -= n;
+			return *this;
+		}
+
+		friend spmc_polymorphic_vector_iterator operator+(
+			spmc_polymorphic_vector_iterator const& lhs, difference_type const n) noexcept
+		{
+			return spmc_polymorphic_vector_iterator{ lhs.h_ + n };
+		}
+
+		friend spmc_polymorphic_vector_iterator operator-(
+			spmc_polymorphic_vector_iterator const& lhs, difference_type const n) noexcept
+		{
+			return spmc_polymorphic_vector_iterator{ lhs.h_ - n };
+		}
+
+		friend difference_type operator-(spmc_polymorphic_vector_iterator const& lhs,
+			spmc_polymorphic_vector_iterator const& rhs) noexcept
+		{
+			return lhs.h_ - rhs.h_;
+		}
+
+		friend bool operator==(spmc_polymorphic_vector_iterator const& lhs,
+			spmc_polymorphic_vector_iterator const& rhs) noexcept
+		{
+			return lhs.h_ == rhs.h_;
+		}
+
+		friend bool operator!=(spmc_polymorphic_vector_iterator const& lhs,
+			spmc_polymorphic_vector_iterator const& rhs) noexcept
+		{
+			return lhs.h_ != rhs.h_;
+		}
+
+		friend bool operator<(spmc_polymorphic_vector_iterator const& lhs,
+			spmc_polymorphic_vector_iterator const& rhs) noexcept
+		{
+			return lhs.h_ < rhs.h_;
+		}
+
+	private:
+		friend class spmc_polymorphic_vector<B>;
+
+		explicit spmc_polymorphic_vector_iterator(gut::polymorphic_handle const* h) noexcept
+			: h_{ h }
+		{}
+
+		gut::polymorphic_handle const* h_;
+	};
+
+	// single-producer/multi-consumer append-only polymorphic container.
+	// the arena and the handle table are reserved up front and never grow, so
+	// a reader holding a reference into the published prefix can never have it
+	// invalidated by the producer. emplace_back() publishes the new element with
+	// a release store of the size; readers acquire-load the size and may access
+	// every element below it without locking.
+	template<class B>
+	class spmc_polymorphic_vector
+	{
+	public:
+		using byte = gut::contiguous_allocator::byte;
+
+		using value_type = B;
+		using reference = value_type&;
+		using const_reference = value_type const&;
+		using pointer = value_type*;
+		using const_pointer = value_type const*;
+
+		using const_iterator = gut::spmc_polymorphic_vector_iterator<B>;
+		using size_type = gut::contiguous_allocator::size_type;
+
+		// destructor
+		~spmc_polymorphic_vector();
+
+		// constructors
+		spmc_polymorphic_vector(size_type const byte_capacity, size_type const max_elements);
+
+		spmc_polymorphic_vector(spmc_polymorphic_vector&&) = delete;
+		spmc_polymorphic_vector& operator=(spmc_polymorphic_vector&&) = delete;
+
+		spmc_polymorphic_vector(spmc_polymorphic_vector const&) = delete;
+		spmc_polymorphic_vector& operator=(spmc_polymorphic_vector const&) = delete;
+
+		// producer
+		template<class D, gut::enable_if_derived_t<B, D> = 0>
+		void push_back(D&& value);
+
+		template<class D, class... Args, gut::enable_if_derived_t<B, D> = 0>
+		void emplace_back(Args&&... args);
+
+		template<class D>
+		bool can_emplace() const noexcept;
+
+		// requires that no consumer is accessing the container
+		void clear();
+
+		// consumers
+		const_iterator begin() const noexcept;
+		const_iterator end() const noexcept;
+		const_iterator cbegin() const noexcept;
+		const_iterator cend() const noexcept;
+
+		const_reference operator[](size_type const i) const noexcept;
+		const_reference at(size_type const i) const;
+
+		size_type size() const noexcept;
+		bool empty() const noexcept;
+
+		size_type capacity() const noexcept;
+		size_type byte_capacity() const noexcept;
+
+	private:
+		void ensure_index_bounds(size_type const i) const;
+
+		gut::contiguous_allocator alloc_;
+		std::atomic<size_type> size_;
+	};
+}
+//////////////////////////////////////////////////////////////////////////////////
+// destructor
+//////////////////////////////////////////////////////////////////////////////////
+template<class B>
+inline gut::spmc_polymorphic_vector<B>::~spmc_polymorphic_vector()
+{
+	alloc_.destroy_elements(0, alloc_.handles_.size());
+}
+//////////////////////////////////////////////////////////////////////////////////
+// constructors
+//////////////////////////////////////////////////////////////////////////////////
+template<class B>
+inline gut::spmc_polymorphic_vector<B>::spmc_polymorphic_vector(
+	size_type const byte_capacity, size_type const max_elements)
+	: alloc_{ byte_capacity }
+	, size_{ 0 }
+{
+	alloc_.handles_.reserve(max_elements);
+}
+//////////////////////////////////////////////////////////////////////////////////
+// producer
+//////////////////////////////////////////////////////////////////////////////////
+template<class B>
+template<class D, gut::enable_if_derived_t<B, D>>
+inline void gut::spmc_polymorphic_vector<B>::push_back(D&& value)
+{
+	emplace_back<std::decay_t<D>>(std::forward<D>(value));
+}
+
+template<class B>
+template<class D, class... Args, gut::enable_if_derived_t<B, D>>
+inline void gut::spmc_polymorphic_vector<B>::emplace_back(Args&&... args)
+{
+	if (!can_emplace<D>())
+	{
+		throw std::length_error
+		{
+			"spmc_polymorphic_vector<B>::emplace_back( Args&&... args );\n"
+			"reserved capacity exhausted"
+		};
+	}
+
+	// the reserved capacity guarantees that allocate() neither moves the arena
+	// nor reallocates the handle table under the consumers
+	size_type const offset{ alloc_.offset_ };
+	D* p{ alloc_.allocate<D>() };
+
+	try
+	{
+		::new (p) D{ std::forward<Args>(args)... };
+	}
+	catch (...)
+	{
+		alloc_.handles_.pop_back();
+		alloc_.offset_ = offset;
+		throw;
+	}
+
+	size_.store(alloc_.handles_.size(), std::memory_order_release);
+}
+
+template<class B>
+template<class D>
+inline bool gut::spmc_polymorphic_vector<B>::can_emplace() const noexcept
+{
+	byte* blk = alloc_.data_ + alloc_.offset_;
+	byte* src = make_aligned(blk, alignof(D));
+
+	return alloc_.handles_.size() != alloc_.handles_.capacity() &&
+		alloc_.cap_ - alloc_.offset_ >= sizeof(D) + (src - blk);
+}
+
+template<class B>
+inline void gut::spmc_polymorphic_vector<B>::clear()
+{
+	size_.store(0, std::memory_order_relaxed);
+	alloc_.clear();
+}
+//////////////////////////////////////////////////////////////////////////////////
+// consumers
+//////////////////////////////////////////////////////////////////////////////////
+template<class B>
+inline typename gut::spmc_polymorphic_vector<B>::const_iterator
+gut::spmc_polymorphic_vector<B>::begin() const noexcept
+{
+	return const_iterator{ alloc_.handles_.data() };
+}
+
+template<class B>
+inline typename gut::spmc_polymorphic_vector<B>::const_iterator
+gut::spmc_polymorphic_vector<B>::end() const noexcept
+{
+	return const_iterator{ alloc_.handles_.data() + size() };
+}
+
+template<class B>
+inline typename gut::spmc_polymorphic_vector<B>::const_iterator
+gut::spmc_polymorphic_vector<B>::cbegin() const noexcept
+{
+	return begin();
+}
+
+template<class B>
+inline typename gut::spmc_polymorphic_vector<B>::const_iterator
+gut::spmc_polymorphic_vector<B>::cend() const noexcept
+{
+	return end();
+}
+
+template<class B>
+inline typename gut::spmc_polymorphic_vector<B>::const_reference
+gut::spmc_polymorphic_vector<B>::operator[](size_type const i) const noexcept
+{
+	assert(i < size());
+	return *reinterpret_cast<const_pointer>(alloc_.handles_.data()[i]->src());
+}
+
+template<class B>
+inline typename gut::spmc_polymorphic_vector<B>::const_reference
+gut::spmc_polymorphic_vector<B>::at(size_type const i) const
+{
+	ensure_index_bounds(i);
+	return *reinterpret_cast<const_pointer>(alloc_.handles_.data()[i]->src());
+}
+
+template<class B>
+inline typename gut::spmc_polymorphic_vector<B>::size_type
+gut::spmc_polymorphic_vector<B>::size() const noexcept
+{
+	return size_.load(std::memory_order_acquire);
+}
+
+template<class B>
+inline bool gut::spmc_polymorphic_vector<B>::empty() const noexcept
+{
+	return size() == 0;
+}
+
+template<class B>
+inline typename gut::spmc_polymorphic_vector<B>::size_type
+gut::spmc_polymorphic_vector<B>::capacity() const noexcept
+{
+	return alloc_.handles_.capacity();
+}
+
+template<class B>
+inline typename gut::spmc_polymorphic_vector<B>::size_type
+gut::spmc_polymorphic_vector<B>::byte_capacity() const noexcept
+{
+	return alloc_.cap_;
+}
+///////////////////////////////////////////////////////////////////////////////
+// private member functions
+///////////////////////////////////////////////////////////////////////////////
+template<class B>
+inline void gut::spmc_polymorphic_vector<B>::ensure_index_bounds(size_type const i) const
+{
+	if (i >= size())
+	{
+		throw std::out_of_range
+		{
+			"spmc_polymorphic_vector<B>::ensure_index_bounds( size_type const i );\n"
+			"index out of range"
+		};
+	}
+}
+#endif // GUT_SPMC_POLYMORPHIC_VECTOR_H
\ No newline at end of file
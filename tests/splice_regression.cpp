@@ -0,0 +1,207 @@
+// regression checks for polymorphic_vector::splice.
+//
+// a spliced vector whose objects are out of handle order, or that has gaps
+// left by incremental compaction, must not be block copied as it is: the
+// elements erased afterwards were destroyed through broken handles. gaps
+// recorded before a sort must not survive it, even when the sort puts the
+// objects back in order. a splice into an empty vector must keep the
+// placement and compaction of the destination. the checks abort on the
+// first failure; run them under AddressSanitizer to also catch the memory
+// errors.
+//
+// build from the repository root:
+//     g++ -std=c++14 -g -fsanitize=address,undefined -I. tests/splice_regression.cpp
+//         contiguous_allocator.cpp arena_backing.cpp simd_kernels.cpp handle_base.cpp
+//         -o splice_regression
+
+#include "polymorphic_vector.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <type_traits>
+#include <vector>
+
+namespace
+{
+	int live{ 0 };
+
+	struct element
+	{
+		explicit element(int const v) : value{ v } { ++live; }
+		element(element const& other) : value{ other.value } { ++live; }
+		virtual ~element() { --live; }
+
+		virtual int get() const { return value; }
+
+		int value;
+		char payload[12];
+	};
+
+	struct larger : element
+	{
+		explicit larger(int const v) : element{ v } {}
+
+		int get() const override { return value + 1000; }
+
+		char more[40];
+	};
+}
+
+namespace gut
+{
+	// splice copies vectors of trivially relocatable elements as one block
+	template<>
+	struct is_trivially_relocatable<element> : std::true_type {};
+
+	template<>
+	struct is_trivially_relocatable<larger> : std::true_type {};
+}
+
+namespace
+{
+	void check(bool const condition, char const* what)
+	{
+		if (!condition)
+		{
+			std::fprintf(stderr, "failed: %s\n", what);
+			std::abort();
+		}
+	}
+
+	void check_values(gut::polymorphic_vector<element> const& pv, std::vector<int> const& expected,
+		char const* what)
+	{
+		check(pv.size() == expected.size(), what);
+		for (std::size_t i{ 0 }; i != expected.size(); ++i)
+		{
+			check(pv[i].get() == expected[i], what);
+		}
+	}
+
+	void splice_sorted()
+	{
+		gut::polymorphic_vector<element> a;
+		for (int i{ 0 }; i != 4; ++i)
+		{
+			a.emplace_back<element>(i);
+		}
+
+		// sorting reverses the handles of b against its objects
+		gut::polymorphic_vector<element> b;
+		for (int i{ 0 }; i != 8; ++i)
+		{
+			b.emplace_back<element>(100 - i);
+		}
+		gut::sort(b, [](element const& x, element const& y) { return x.value < y.value; });
+
+		a.splice(a.cend(), std::move(b));
+		std::vector<int> expected{ 0, 1, 2, 3, 93, 94, 95, 96, 97, 98, 99, 100 };
+		check_values(a, expected, "splice of a sorted vector");
+
+		a.erase(a.cbegin() + 1, a.cbegin() + 3);
+		expected.erase(expected.begin() + 1, expected.begin() + 3);
+		check_values(a, expected, "erase after splice of a sorted vector");
+
+		a.erase(a.cbegin() + 4);
+		expected.erase(expected.begin() + 4);
+		check_values(a, expected, "erase after splice of a sorted vector");
+	}
+
+	void splice_with_gaps()
+	{
+		gut::polymorphic_vector<element> a;
+		for (int i{ 1 }; i != 4; ++i)
+		{
+			a.emplace_back<element>(i);
+		}
+
+		// incremental compaction leaves the bytes of the erased front as a gap
+		gut::polymorphic_vector<element> b;
+		b.set_compaction(gut::compaction::incremental);
+		for (int i{ 10 }; i != 18; ++i)
+		{
+			b.emplace_back<element>(i);
+		}
+		b.erase(b.cbegin());
+
+		a.splice(a.cend(), std::move(b));
+		std::vector<int> expected{ 1, 2, 3, 11, 12, 13, 14, 15, 16, 17 };
+		check_values(a, expected, "splice of a vector with gaps");
+
+		// the first spliced element may only grow into the gap in front of it
+		a.replace<larger>(a.cbegin() + 3, 7);
+		expected[3] = 1007;
+		check_values(a, expected, "replace after splice of a vector with gaps");
+
+		a.erase(a.cbegin() + 1);
+		expected.erase(expected.begin() + 1);
+		a.erase(a.cbegin() + 3);
+		expected.erase(expected.begin() + 3);
+		check_values(a, expected, "erase after splice of a vector with gaps");
+	}
+
+	void splice_then_sort_in_order()
+	{
+		gut::polymorphic_vector<element> a;
+		a.set_compaction(gut::compaction::incremental);
+		for (int i{ 1 }; i != 4; ++i)
+		{
+			a.emplace_back<element>(i);
+		}
+		a.erase(a.cbegin() + 1);
+
+		// the splice takes the handles out of order with a gap recorded, and
+		// sorting puts them back in order under other indices
+		gut::polymorphic_vector<element> b;
+		b.emplace_back<element>(9);
+		a.splice(a.cbegin(), std::move(b));
+		gut::sort(a, [](element const& x, element const& y) { return x.value < y.value; });
+
+		a.erase(a.cbegin() + 2);
+		a.emplace_back<element>(7);
+		a.emplace_back<element>(8);
+		check_values(a, { 1, 3, 7, 8 }, "push after splice, sort and erase");
+	}
+
+	void splice_into_empty()
+	{
+		gut::polymorphic_vector<element> a{ 0, gut::placement::per_element() };
+		a.set_compaction(gut::compaction::incremental);
+
+		gut::polymorphic_vector<element> b;
+		for (int i{ 0 }; i != 5; ++i)
+		{
+			b.emplace_back<element>(i);
+		}
+
+		a.splice(a.cend(), std::move(b));
+		check_values(a, { 0, 1, 2, 3, 4 }, "splice into an empty vector");
+		for (auto const& x : a)
+		{
+			check(reinterpret_cast<std::uintptr_t>(&x) % gut::destructive_interference_size == 0,
+				"splice into an empty vector ignored its placement");
+		}
+
+		// incremental compaction leaves the erased front as a gap, eager does not
+		a.erase(a.cbegin());
+		check(a.stats().gap_bytes != 0, "splice into an empty vector changed its compaction");
+
+		b.emplace_back<element>(0);
+		b.emplace_back<element>(1);
+		b.erase(b.cbegin());
+		check(b.stats().gap_bytes == 0, "splice into an empty vector changed the compaction of other");
+	}
+}
+
+int main()
+{
+	splice_sorted();
+	splice_with_gaps();
+	splice_then_sort_in_order();
+	splice_into_empty();
+
+	check(live == 0, "elements leaked or destroyed twice");
+	std::puts("splice regression checks passed");
+	return 0;
+}
@@ -0,0 +1,331 @@
+#include "trace.h"
+#include <atomic>
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace
+{
+	constexpr char magic[8]{ 'G', 'U', 'T', 'T', 'R', 'A', 'C', 'E' };
+	constexpr unsigned char version{ 1 };
+
+	// the flag rides in the top bit of the operation byte
+	constexpr unsigned char relocatable_bit{ 0x80 };
+
+	// arguments following the container of every operation
+	constexpr unsigned char arg_count[]{ 1, 0, 3, 2, 0, 1, 1, 1, 2, 0, 0, 1, 1, 4 };
+
+	struct writer
+	{
+		std::mutex lock;
+		std::atomic<bool> active{ false };
+		std::FILE* file{ nullptr };
+		std::uint64_t next_container{ 0 };
+		std::uint64_t next_type{ 0 };
+		std::unordered_map<void const*, std::uint64_t> containers;
+		std::unordered_map<std::type_info const*, std::uint64_t> types;
+
+		std::uint64_t id(void const* container)
+		{
+			auto it = containers.find(container);
+			if (it == containers.end())
+			{
+				it = containers.emplace(container, next_container++).first;
+			}
+			return it->second;
+		}
+
+		void put(std::uint64_t v)
+		{
+			// LEB128, so that small ids and sizes take a byte or two
+			unsigned char buf[10];
+			std::size_t n{ 0 };
+			do
+			{
+				unsigned char b{ static_cast<unsigned char>(v & 0x7f) };
+				v >>= 7;
+				buf[n++] = static_cast<unsigned char>(v ? b | 0x80 : b);
+			} while (v);
+			std::fwrite(buf, 1, n, file);
+		}
+
+		void put_op(gut::trace_op const op, bool const flag = false)
+		{
+			unsigned char b{ static_cast<unsigned char>(op) };
+			std::fputc(flag ? b | relocatable_bit : b, file);
+		}
+
+		std::uint64_t type_id(std::type_info const& type)
+		{
+			auto it = types.find(&type);
+			if (it == types.end())
+			{
+				it = types.emplace(&type, next_type++).first;
+			}
+			return it->second;
+		}
+	};
+
+	writer& the_writer()
+	{
+		static writer w;
+		return w;
+	}
+
+	bool get(std::FILE* f, std::uint64_t& v)
+	{
+		v = 0;
+		for (unsigned shift{ 0 }; shift < 64; shift += 7)
+		{
+			int const c{ std::fgetc(f) };
+			if (c == EOF)
+			{
+				return false;
+			}
+			v |= std::uint64_t(c & 0x7f) << shift;
+			if (!(c & 0x80))
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+}
+//////////////////////////////////////////////////////////////////////////////////
+// recording
+//////////////////////////////////////////////////////////////////////////////////
+bool gut::start_trace(char const* path)
+{
+	stop_trace();
+
+	auto& w = the_writer();
+	std::lock_guard<std::mutex> guard{ w.lock };
+
+	w.file = std::fopen(path, "wb");
+	if (!w.file)
+	{
+		return false;
+	}
+	std::fwrite(magic, 1, sizeof(magic), w.file);
+	std::fputc(version, w.file);
+
+	w.next_container = 0;
+	w.next_type = 0;
+	w.containers.clear();
+	w.types.clear();
+	w.active.store(true, std::memory_order_release);
+	return true;
+}
+
+void gut::stop_trace() noexcept
+{
+	auto& w = the_writer();
+	std::lock_guard<std::mutex> guard{ w.lock };
+
+	w.active.store(false, std::memory_order_relaxed);
+	if (w.file)
+	{
+		std::fclose(w.file);
+		w.file = nullptr;
+	}
+}
+
+void gut::detail::trace(gut::trace_op const op, void const* container,
+	std::uint64_t const a, std::uint64_t const b) noexcept
+{
+	auto& w = the_writer();
+	if (!w.active.load(std::memory_order_acquire))
+	{
+		return;
+	}
+
+	std::lock_guard<std::mutex> guard{ w.lock };
+	if (!w.file)
+	{
+		return;
+	}
+
+	try
+	{
+		w.put_op(op);
+		w.put(w.id(container));
+
+		std::uint64_t const args[]{ a, b };
+		for (unsigned char i{ 0 }; i != arg_count[static_cast<unsigned char>(op)]; ++i)
+		{
+			w.put(args[i]);
+		}
+
+		// an address can be taken by another container once this one is gone
+		if (op == gut::trace_op::destroy)
+		{
+			w.containers.erase(container);
+		}
+	}
+	catch (...)
+	{
+		// out of memory for the id maps; the trace ends here
+		w.active.store(false, std::memory_order_relaxed);
+	}
+}
+
+void gut::detail::trace_pair(gut::trace_op const op, void const* container, void const* other,
+	std::uint64_t const a) noexcept
+{
+	auto& w = the_writer();
+	if (!w.active.load(std::memory_order_acquire))
+	{
+		return;
+	}
+
+	std::lock_guard<std::mutex> guard{ w.lock };
+	if (!w.file)
+	{
+		return;
+	}
+
+	try
+	{
+		w.put_op(op);
+		w.put(w.id(container));
+		if (op == gut::trace_op::splice)
+		{
+			w.put(a);
+		}
+		w.put(w.id(other));
+	}
+	catch (...)
+	{
+		w.active.store(false, std::memory_order_relaxed);
+	}
+}
+
+void gut::detail::trace_emplace(void const* container, std::type_info const& type,
+	std::size_t const size, std::size_t const align, bool const trivially_relocatable) noexcept
+{
+	auto& w = the_writer();
+	if (!w.active.load(std::memory_order_acquire))
+	{
+		return;
+	}
+
+	std::lock_guard<std::mutex> guard{ w.lock };
+	if (!w.file)
+	{
+		return;
+	}
+
+	try
+	{
+		w.put_op(gut::trace_op::emplace, trivially_relocatable);
+		w.put(w.id(container));
+		w.put(w.type_id(type));
+		w.put(size);
+		w.put(align);
+	}
+	catch (...)
+	{
+		w.active.store(false, std::memory_order_relaxed);
+	}
+}
+
+void gut::detail::trace_replace(void const* container, std::size_t const i, std::type_info const& type,
+	std::size_t const size, std::size_t const align, bool const trivially_relocatable) noexcept
+{
+	auto& w = the_writer();
+	if (!w.active.load(std::memory_order_acquire))
+	{
+		return;
+	}
+
+	std::lock_guard<std::mutex> guard{ w.lock };
+	if (!w.file)
+	{
+		return;
+	}
+
+	try
+	{
+		w.put_op(gut::trace_op::replace, trivially_relocatable);
+		w.put(w.id(container));
+		w.put(i);
+		w.put(w.type_id(type));
+		w.put(size);
+		w.put(align);
+	}
+	catch (...)
+	{
+		w.active.store(false, std::memory_order_relaxed);
+	}
+}
+//////////////////////////////////////////////////////////////////////////////////
+// reading
+//////////////////////////////////////////////////////////////////////////////////
+gut::trace_reader::~trace_reader() noexcept
+{
+	if (file_)
+	{
+		std::fclose(file_);
+	}
+}
+
+gut::trace_reader::trace_reader(char const* path)
+	: file_{ std::fopen(path, "rb") }
+{
+	char head[sizeof(magic) + 1];
+	if (!file_ ||
+		std::fread(head, 1, sizeof(head), file_) != sizeof(head) ||
+		std::memcmp(head, magic, sizeof(magic)) != 0 ||
+		static_cast<unsigned char>(head[sizeof(magic)]) != version)
+	{
+		if (file_)
+		{
+			std::fclose(file_);
+		}
+		throw std::runtime_error
+		{
+			"trace_reader::trace_reader( char const* path );\n"
+			"not a trace of this version"
+		};
+	}
+}
+
+bool gut::trace_reader::next(trace_record& r)
+{
+	int const c{ std::fgetc(file_) };
+	if (c == EOF)
+	{
+		return false;
+	}
+
+	unsigned char const op{ static_cast<unsigned char>(c & ~relocatable_bit) };
+	if (op >= sizeof(arg_count))
+	{
+		throw std::runtime_error
+		{
+			"trace_reader::next( trace_record& r );\n"
+			"unknown operation"
+		};
+	}
+
+	r.op = static_cast<gut::trace_op>(op);
+	r.trivially_relocatable = (c & relocatable_bit) != 0;
+	r.args[0] = r.args[1] = r.args[2] = r.args[3] = 0;
+
+	bool ok{ get(file_, r.container) };
+	for (unsigned char i{ 0 }; ok && i != arg_count[op]; ++i)
+	{
+		ok = get(file_, r.args[i]);
+	}
+
+	if (!ok)
+	{
+		throw std::runtime_error
+		{
+			"trace_reader::next( trace_record& r );\n"
+			"truncated trace"
+		};
+	}
+	return true;
+}
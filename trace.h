@@ -0,0 +1,98 @@
+#ifndef GUT_TRACE_H
+#define GUT_TRACE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <typeinfo>
+
+namespace gut
+{
+	// the operations of a contiguous_allocator recorded in a trace
+	enum class trace_op : unsigned char
+	{
+		create,
+		destroy,
+		emplace,
+		erase,
+		pop_back,
+		copy,
+		move,
+		swap,
+		splice,
+		clear,
+		compact_in_order,
+		compact,
+		compact_step,
+		replace
+	};
+
+	// one recorded operation. containers and element types are numbered in
+	// order of first appearance; the arguments are
+	//     create        initial capacity in bytes
+	//     emplace       type, size, alignment
+	//     erase         first, last handle index
+	//     copy, move    source container
+	//     swap          other container
+	//     splice        handle index, source container
+	//     compact       gut::packing
+	//     compact_step  byte budget
+	//     replace       handle index, type, size, alignment
+	struct trace_record
+	{
+		trace_op op;
+		bool trivially_relocatable;
+		std::uint64_t container;
+		std::uint64_t args[4];
+	};
+
+	// with GUT_TRACE defined for every translation unit, each allocator
+	// records what is done to it into the file opened by start_trace(), until
+	// stop_trace(), from any thread. handle permutations, as by sort(), are
+	// not recorded; neither are containers filling handles_ on their own,
+	// like polymorphic_vector_serializer or a parallel transform_plan::run()
+	bool start_trace(char const* path);
+	void stop_trace() noexcept;
+
+	// reads back a trace written through start_trace()
+	class trace_reader
+	{
+	public:
+		~trace_reader() noexcept;
+
+		// throws std::runtime_error if path is not a trace
+		explicit trace_reader(char const* path);
+
+		trace_reader(trace_reader const&) = delete;
+		trace_reader& operator=(trace_reader const&) = delete;
+
+		// false at the end of the trace
+		bool next(trace_record& r);
+
+	private:
+		std::FILE* file_;
+	};
+
+	namespace detail
+	{
+		void trace(gut::trace_op const op, void const* container,
+			std::uint64_t const a = 0, std::uint64_t const b = 0) noexcept;
+
+		void trace_pair(gut::trace_op const op, void const* container, void const* other,
+			std::uint64_t const a = 0) noexcept;
+
+		void trace_emplace(void const* container, std::type_info const& type,
+			std::size_t const size, std::size_t const align, bool const trivially_relocatable) noexcept;
+
+		void trace_replace(void const* container, std::size_t const i, std::type_info const& type,
+			std::size_t const size, std::size_t const align, bool const trivially_relocatable) noexcept;
+	}
+}
+
+#ifdef GUT_TRACE
+#define GUT_TRACE_RECORD(call) gut::detail::call
+#else
+#define GUT_TRACE_RECORD(call) ((void)0)
+#endif
+
+#endif // GUT_TRACE_H
@@ -0,0 +1,119 @@
+#ifndef GUT_TYPE_FILTER_ITERATOR_H
+#define GUT_TYPE_FILTER_ITERATOR_H
+
+#include "polymorphic_handle.h"
+#include <cassert>
+#include <cstddef>
+#include <iterator>
+#include <type_traits>
+
+namespace gut
+{
+	// forward iterator over the elements of a polymorphic_vector that are
+	// exactly a D, given as D&. non-matching elements are skipped by their
+	// handles alone, so only the objects visited are ever touched
+	template<class D, bool is_const>
+	class type_filter_iterator final
+	{
+	public:
+		using iterator_category = std::forward_iterator_tag;
+		using value_type = D;
+		using difference_type = std::ptrdiff_t;
+		using reference = std::conditional_t<is_const, D const&, D&>;
+		using pointer = std::conditional_t<is_const, D const*, D*>;
+
+		using handle_pointer = std::conditional_t
+		<
+			is_const,
+			gut::polymorphic_handle const*,
+			gut::polymorphic_handle*
+		>;
+
+		type_filter_iterator(handle_pointer cur, handle_pointer end) noexcept
+			: cur_{ cur }
+			, end_{ end }
+		{
+			skip();
+		}
+
+		reference operator*() const noexcept
+		{
+			assert(cur_ != end_);
+			return *reinterpret_cast<pointer>((*cur_)->src());
+		}
+
+		pointer operator->() const noexcept
+		{
+			assert(cur_ != end_);
+			return reinterpret_cast<pointer>((*cur_)->src());
+		}
+
+		type_filter_iterator& operator++() noexcept
+		{
+			assert(cur_ != end_);
+			++cur_;
+			skip();
+			return *this;
+		}
+
+		type_filter_iterator operator++(int) noexcept
+		{
+			auto it = *this;
+			++*this;
+			return it;
+		}
+
+		friend bool operator==(type_filter_iterator const& lhs,
+			type_filter_iterator const& rhs) noexcept
+		{
+			return lhs.cur_ == rhs.cur_;
+		}
+
+		friend bool operator!=(type_filter_iterator const& lhs,
+			type_filter_iterator const& rhs) noexcept
+		{
+			return lhs.cur_ != rhs.cur_;
+		}
+
+	private:
+		void skip() noexcept
+		{
+			while (cur_ != end_ && !cur_->template holds<D>())
+			{
+				++cur_;
+			}
+		}
+
+		handle_pointer cur_;
+		handle_pointer end_;
+	};
+
+	// the result of polymorphic_vector<B>::of_type<D>(), for range-based for
+	template<class D, bool is_const>
+	class type_filter_range
+	{
+	public:
+		using iterator = gut::type_filter_iterator<D, is_const>;
+		using handle_pointer = typename iterator::handle_pointer;
+
+		type_filter_range(handle_pointer first, handle_pointer last) noexcept
+			: first_{ first }
+			, last_{ last }
+		{}
+
+		iterator begin() const noexcept
+		{
+			return{ first_, last_ };
+		}
+
+		iterator end() const noexcept
+		{
+			return{ last_, last_ };
+		}
+
+	private:
+		handle_pointer first_;
+		handle_pointer last_;
+	};
+}
+#endif // GUT_TYPE_FILTER_ITERATOR_H
@@ -0,0 +1,202 @@
+#ifndef GUT_TYPE_REGISTRY_H
+#define GUT_TYPE_REGISTRY_H
+
+#include "handle.h"
+#include "polymorphic_handle.h"
+#include "relocation_traits.h"
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <stdexcept>
+#include <typeindex>
+#include <typeinfo>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+namespace gut
+{
+	// maps stable, user chosen type ids to everything needed to persist and
+	// rebuild elements of a polymorphic_vector<B> without knowing their types.
+	//
+	// add<D>(id) registers an image type: its bytes are written as they are and
+	// the element is revived by copy construction from the persisted image, which
+	// also restores its vptr. this requires gut::is_trivially_relocatable<D> and
+	// that D holds no pointers into the writing process.
+	//
+	// add<D, Hooks>(id) registers any other type through a hooks class providing
+	//     static void save(D const& value, std::vector<unsigned char>& out);
+	//     static bool load(void* dst, unsigned char const*& in, unsigned char const* end);
+	// where load() constructs a D at dst and advances in past what save() wrote.
+	// it must not read at or past end; if what it needs is not there it returns
+	// false without constructing anything.
+	template<class B>
+	class type_registry
+	{
+	public:
+		using byte = unsigned char;
+		using size_type = std::size_t;
+		using type_id = std::uint32_t;
+
+		struct entry
+		{
+			type_id id;
+			size_type size;
+			size_type align;
+
+			void (*revive)(void* dst, void const* image);
+			void (*save)(B const& value, std::vector<byte>& out);
+			bool (*load)(void* dst, byte const*& in, byte const* end);
+			gut::polymorphic_handle (*make_handle)(void* blk, void* src);
+		};
+
+		template<class D>
+		void add(type_id const id);
+
+		template<class D, class Hooks>
+		void add(type_id const id);
+
+		entry const& find(type_id const id) const;
+		entry const& find(std::type_info const& type) const;
+
+		size_type size() const noexcept;
+
+	private:
+		template<class D>
+		static entry make_entry(type_id const id) noexcept;
+
+		template<class D>
+		static void revive(void* dst, void const* image);
+
+		template<class D, class Hooks>
+		static void save(B const& value, std::vector<byte>& out);
+
+		template<class D>
+		static gut::polymorphic_handle make_handle(void* blk, void* src) noexcept;
+
+		void insert(entry const& e, std::type_info const& type);
+
+		std::vector<entry> entries_;
+		std::unordered_map<type_id, size_type> by_id_;
+		std::unordered_map<std::type_index, size_type> by_type_;
+	};
+}
+//////////////////////////////////////////////////////////////////////////////////
+// registration
+//////////////////////////////////////////////////////////////////////////////////
+template<class B>
+template<class D>
+inline void gut::type_registry<B>::add(type_id const id)
+{
+	static_assert(std::is_base_of<B, D>::value, "D must derive from B");
+	static_assert(gut::is_trivially_relocatable<D>::value,
+		"image types must be trivially relocatable; register hooks otherwise");
+	static_assert(std::is_copy_constructible<D>::value,
+		"image types are revived through their copy constructor");
+
+	entry e{ make_entry<D>(id) };
+	e.revive = &type_registry::revive<D>;
+	insert(e, typeid(D));
+}
+
+template<class B>
+template<class D, class Hooks>
+inline void gut::type_registry<B>::add(type_id const id)
+{
+	static_assert(std::is_base_of<B, D>::value, "D must derive from B");
+
+	entry e{ make_entry<D>(id) };
+	e.save = &type_registry::save<D, Hooks>;
+	e.load = &Hooks::load;
+	insert(e, typeid(D));
+}
+//////////////////////////////////////////////////////////////////////////////////
+// lookup
+//////////////////////////////////////////////////////////////////////////////////
+template<class B>
+inline typename gut::type_registry<B>::entry const&
+gut::type_registry<B>::find(type_id const id) const
+{
+	auto it = by_id_.find(id);
+	if (it == by_id_.end())
+	{
+		throw std::out_of_range
+		{
+			"type_registry<B>::find( type_id const id );\n"
+			"unregistered type id"
+		};
+	}
+	return entries_[it->second];
+}
+
+template<class B>
+inline typename gut::type_registry<B>::entry const&
+gut::type_registry<B>::find(std::type_info const& type) const
+{
+	auto it = by_type_.find(std::type_index{ type });
+	if (it == by_type_.end())
+	{
+		throw std::out_of_range
+		{
+			"type_registry<B>::find( std::type_info const& type );\n"
+			"unregistered type"
+		};
+	}
+	return entries_[it->second];
+}
+
+template<class B>
+inline typename gut::type_registry<B>::size_type
+gut::type_registry<B>::size() const noexcept
+{
+	return entries_.size();
+}
+//////////////////////////////////////////////////////////////////////////////////
+// private member functions
+//////////////////////////////////////////////////////////////////////////////////
+template<class B>
+template<class D>
+inline typename gut::type_registry<B>::entry
+gut::type_registry<B>::make_entry(type_id const id) noexcept
+{
+	return{ id, sizeof(D), alignof(D), nullptr, nullptr, nullptr, &type_registry::make_handle<D> };
+}
+
+template<class B>
+template<class D>
+inline void gut::type_registry<B>::revive(void* dst, void const* image)
+{
+	::new (dst) D{ *reinterpret_cast<D const*>(image) };
+}
+
+template<class B>
+template<class D, class Hooks>
+inline void gut::type_registry<B>::save(B const& value, std::vector<byte>& out)
+{
+	Hooks::save(static_cast<D const&>(value), out);
+}
+
+template<class B>
+template<class D>
+inline gut::polymorphic_handle gut::type_registry<B>::make_handle(void* blk, void* src) noexcept
+{
+	return gut::polymorphic_handle{ gut::handle<D>{ blk, src } };
+}
+
+template<class B>
+inline void gut::type_registry<B>::insert(entry const& e, std::type_info const& type)
+{
+	if (by_id_.count(e.id) || by_type_.count(std::type_index{ type }))
+	{
+		throw std::invalid_argument
+		{
+			"type_registry<B>::insert( entry const& e, std::type_info const& type );\n"
+			"type or type id registered twice"
+		};
+	}
+
+	by_id_.emplace(e.id, entries_.size());
+	by_type_.emplace(std::type_index{ type }, entries_.size());
+	entries_.push_back(e);
+}
+#endif // GUT_TYPE_REGISTRY_H
\ No newline at end of file